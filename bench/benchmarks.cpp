@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include "batch.hpp"
+#include "output_writer.hpp"
+#include "puzzle_reader.hpp"
+#include "solver.hpp"
+#include "unit_scan.hpp"
+
+
+#ifndef SUDOKU_BENCH_CORPUS
+#define SUDOKU_BENCH_CORPUS "corpus"
+#endif
+
+
+/**
+ * A puzzle file loaded into memory: the raw bytes, and the puzzles as views
+ * into them.
+ */
+struct Corpus
+{
+  std::string name{};
+  std::string data{};
+  std::vector<std::string_view> puzzles{};
+
+  explicit Corpus(const std::filesystem::path& path)
+    : name{path.stem().string()}
+  {
+    MappedFile file{path.string()};
+    data = file.view();
+
+    RecordReader reader{data};
+    for(std::string_view puzzle; reader.next(puzzle);)
+    {
+      puzzles.push_back(puzzle);
+    }
+  }
+};
+
+
+/**
+ * Run body once per puzzle of the corpus for every iteration, and report the
+ * rate in puzzles.
+ */
+template <typename Body>
+void for_each_puzzle(benchmark::State& state, const Corpus& corpus, Body&& body)
+{
+  for(auto _ : state)
+  {
+    for(auto puzzle : corpus.puzzles)
+    {
+      body(puzzle);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(corpus.puzzles.size()));
+}
+
+
+void parse(benchmark::State& state, const Corpus& corpus)
+{
+  for_each_puzzle(state, corpus, [](std::string_view puzzle) {
+    SudokuSolver solver{puzzle};
+    benchmark::DoNotOptimize(solver);
+  });
+}
+
+
+/**
+ * Like parse, but reloading one solver instead of constructing one per puzzle.
+ */
+void load(benchmark::State& state, const Corpus& corpus)
+{
+  SudokuSolver solver{Board{}};
+  for_each_puzzle(state, corpus, [&](std::string_view puzzle) {
+    solver.load(puzzle);
+    benchmark::DoNotOptimize(solver);
+  });
+}
+
+
+/**
+ * The grid scan behind update_constraints(), at the SIMD level given as the
+ * benchmark's argument. Levels the CPU lacks are skipped.
+ */
+void update_constraints(benchmark::State& state, const Corpus& corpus)
+{
+  auto level = static_cast<SimdLevel>(state.range(0));
+  if(level > simd_level())
+  {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+
+  std::vector<grid<char, 9>> grids{};
+  for(auto puzzle : corpus.puzzles)
+  {
+    if(puzzle.size() != Geometry<3>::NUM_CELLS)
+    {
+      continue;
+    }
+
+    auto& cells = grids.emplace_back();
+    for(std::size_t cell = 0; cell < cells.size(); ++cell)
+    {
+      cells[cell] = parse_cell<3>(puzzle[cell]);
+    }
+  }
+
+  grid<Geometry<3>::Mask, 9> candidates{};
+  for(auto _ : state)
+  {
+    for(const auto& cells : grids)
+    {
+      benchmark::DoNotOptimize(scan_grid<3>(cells, candidates, level));
+      benchmark::ClobberMemory();
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(grids.size()));
+}
+
+
+void game_state(benchmark::State& state, const Corpus& corpus)
+{
+  std::vector<SudokuSolver> solvers{};
+  for(auto puzzle : corpus.puzzles)
+  {
+    solvers.emplace_back(puzzle);
+  }
+
+  for(auto _ : state)
+  {
+    for(auto& solver : solvers)
+    {
+      benchmark::DoNotOptimize(solver.get_game_state());
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(solvers.size()));
+}
+
+
+template <template <std::size_t> class Engine>
+void solve(benchmark::State& state, const Corpus& corpus)
+{
+  for_each_puzzle(state, corpus, [](std::string_view puzzle) {
+    benchmark::DoNotOptimize(with_solver<Engine>(puzzle, [](auto& solver) { return solver.solve(); }));
+  });
+}
+
+
+/**
+ * Splitting the input buffer into puzzle lines, as the front end reads it.
+ */
+void read_records(benchmark::State& state, const Corpus& corpus)
+{
+  for(auto _ : state)
+  {
+    RecordReader reader{corpus.data};
+    for(std::string_view puzzle; reader.next(puzzle);)
+    {
+      benchmark::DoNotOptimize(puzzle);
+    }
+  }
+
+  state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(corpus.data.size()));
+}
+
+
+/**
+ * End to end throughput of the front end: solve the corpus with solve_batch()
+ * on the number of threads given as the argument and write the solutions out.
+ */
+template <template <std::size_t> class Engine>
+void batch(benchmark::State& state, const Corpus& corpus)
+{
+  auto num_threads = static_cast<std::size_t>(state.range(0));
+  OutputWriter output{"/dev/null"};
+  std::vector<std::string> chunks{};
+
+  for(auto _ : state)
+  {
+    RecordReader reader{corpus.data};
+    std::vector<std::string_view> puzzles{};
+    for(std::string_view puzzle; reader.next(puzzle);)
+    {
+      puzzles.push_back(puzzle);
+    }
+
+    solve_batch<Engine>(std::span<const std::string_view>{puzzles}, num_threads, chunks);
+    for(auto& chunk : chunks)
+    {
+      output.write(chunk);
+    }
+    output.flush();
+  }
+
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(corpus.puzzles.size()));
+}
+
+
+void register_benchmarks(const Corpus& corpus, bool stages)
+{
+  auto name = [&](std::string_view stage) { return std::string{stage} + "/" + corpus.name; };
+
+  if(stages)
+  {
+    benchmark::RegisterBenchmark(name("parse").c_str(), parse, corpus);
+    benchmark::RegisterBenchmark(name("load").c_str(), load, corpus);
+    benchmark::RegisterBenchmark(name("update_constraints").c_str(), update_constraints, corpus)
+      ->Arg(static_cast<std::int64_t>(SimdLevel::SCALAR))
+      ->Arg(static_cast<std::int64_t>(SimdLevel::SSE41))
+      ->Arg(static_cast<std::int64_t>(SimdLevel::AVX2));
+    benchmark::RegisterBenchmark(name("get_game_state").c_str(), game_state, corpus);
+    benchmark::RegisterBenchmark(name("read_records").c_str(), read_records, corpus);
+
+    // one thread, and one per core
+    std::vector<std::int64_t> threads{1};
+    if(std::thread::hardware_concurrency() > 1)
+    {
+      threads.push_back(static_cast<std::int64_t>(std::thread::hardware_concurrency()));
+    }
+    benchmark::RegisterBenchmark(name("batch_backtrack").c_str(), batch<BasicSudokuSolver>, corpus)
+      ->ArgsProduct({threads})
+      ->UseRealTime();
+    benchmark::RegisterBenchmark(name("batch_dlx").c_str(), batch<BasicDlxSolver>, corpus)
+      ->ArgsProduct({threads})
+      ->UseRealTime();
+  }
+
+  benchmark::RegisterBenchmark(name("solve_backtrack").c_str(), solve<BasicSudokuSolver>, corpus);
+  benchmark::RegisterBenchmark(name("solve_dlx").c_str(), solve<BasicDlxSolver>, corpus);
+}
+
+
+/**
+ * Usage: bench [benchmark options] [puzzle files...]
+ *
+ * Without puzzle files the corpora shipped in bench/corpus are measured. The
+ * stage benchmarks run on the easy corpus; every corpus gets the full solves.
+ * Pass --benchmark_out=<file> --benchmark_out_format=json to keep the results.
+ */
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+
+  std::vector<std::filesystem::path> paths{std::next(argv), std::next(argv, argc)};
+  if(paths.empty())
+  {
+    for(auto name : {"easy", "minimal", "17clue", "hardest"})
+    {
+      paths.push_back(std::filesystem::path{SUDOKU_BENCH_CORPUS} / (std::string{name} + ".txt"));
+    }
+  }
+
+  // the benchmarks hold on to the corpora until they have run
+  std::vector<Corpus> corpora{};
+  corpora.reserve(paths.size());
+  try
+  {
+    for(const auto& path : paths)
+    {
+      corpora.emplace_back(path);
+    }
+  }
+  catch(const std::exception& e)
+  {
+    fmt::print(stderr, "{}\n", e.what());
+    return 1;
+  }
+
+  for(std::size_t i = 0; i < corpora.size(); ++i)
+  {
+    register_benchmarks(corpora[i], i == 0);
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
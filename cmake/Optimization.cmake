@@ -0,0 +1,53 @@
+function(enable_optimizations project_name)
+
+  if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU" OR CMAKE_CXX_COMPILER_ID MATCHES ".*Clang")
+    option(ENABLE_NATIVE_OPTIMIZATION "Optimize with -O3 -march=native for the CPU of the build machine" FALSE)
+    if(ENABLE_NATIVE_OPTIMIZATION)
+      # binaries built this way may not run on older CPUs than the one they were built on
+      target_compile_options(${project_name} INTERFACE $<$<NOT:$<CONFIG:Debug>>:-O3> -march=native)
+    endif()
+
+    # A PGO build takes two configurations: GENERATE builds instrumented binaries, the pgo-train target runs them to
+    # record profiles into PGO_PROFILE_DIR, and USE rebuilds optimized for the recorded profiles.
+    set(ENABLE_PGO
+        "OFF"
+        CACHE STRING "Profile-guided optimization phase: OFF, GENERATE or USE")
+    set_property(CACHE ENABLE_PGO PROPERTY STRINGS "OFF" "GENERATE" "USE")
+    set(PGO_PROFILE_DIR
+        "${CMAKE_BINARY_DIR}/pgo-profiles"
+        CACHE PATH "Directory the PGO profiles are written to and read from")
+
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+      # the solvers record profiles from many threads at once
+      set(PGO_GENERATE_FLAGS -fprofile-generate=${PGO_PROFILE_DIR} -fprofile-update=prefer-atomic)
+      # code the training never runs, such as the tests, is not an error
+      set(PGO_USE_FLAGS -fprofile-use=${PGO_PROFILE_DIR} -fprofile-correction -Wno-missing-profile)
+    else()
+      set(PGO_GENERATE_FLAGS -fprofile-generate=${PGO_PROFILE_DIR})
+      # clang reads one merged profile, which pgo-train makes of the raw ones
+      get_filename_component(COMPILER_DIR ${CMAKE_CXX_COMPILER} DIRECTORY)
+      find_program(
+        LLVM_PROFDATA
+        NAMES llvm-profdata
+        HINTS ${COMPILER_DIR})
+      set(PGO_USE_FLAGS -fprofile-use=${PGO_PROFILE_DIR}/default.profdata -Wno-profile-instr-unprofiled
+                        -Wno-profile-instr-out-of-date)
+    endif()
+
+    if(ENABLE_PGO STREQUAL "GENERATE")
+      target_compile_options(${project_name} INTERFACE ${PGO_GENERATE_FLAGS})
+      target_link_options(${project_name} INTERFACE ${PGO_GENERATE_FLAGS})
+    elseif(ENABLE_PGO STREQUAL "USE")
+      if(CMAKE_CXX_COMPILER_ID MATCHES ".*Clang" AND NOT EXISTS "${PGO_PROFILE_DIR}/default.profdata")
+        message(SEND_ERROR "No PGO profile in ${PGO_PROFILE_DIR}, build pgo-train with ENABLE_PGO=GENERATE first")
+      endif()
+      target_compile_options(${project_name} INTERFACE ${PGO_USE_FLAGS})
+      target_link_options(${project_name} INTERFACE ${PGO_USE_FLAGS})
+    elseif(NOT ENABLE_PGO STREQUAL "OFF")
+      message(SEND_ERROR "ENABLE_PGO must be OFF, GENERATE or USE, not '${ENABLE_PGO}'")
+    endif()
+  elseif(ENABLE_NATIVE_OPTIMIZATION OR ENABLE_PGO)
+    message(WARNING "Native optimization and PGO are only supported with GCC and Clang")
+  endif()
+
+endfunction()
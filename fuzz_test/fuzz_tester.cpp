@@ -1,22 +1,201 @@
-#include <iterator>
-#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <fmt/format.h>
 
-[[nodiscard]] auto sum_values(const uint8_t *Data, size_t Size)
+#include "batch.hpp"
+#include "solver.hpp"
+
+// Search nodes the bitmask and DLX engines may spend on a 9x9 puzzle. The hardest puzzles of the benchmark corpus
+// take up to 1024, so running out means the search went wrong. Bigger grids may run out, and are only cross-checked
+// when they don't.
+static constexpr std::uint64_t MAX_NODES = 1 << 16;
+static constexpr std::uint64_t MAX_NODES_OTHER_SIZES = 1 << 10;
+
+
+/**
+ * What an engine made of the input: whether it took the puzzle at all, and
+ * the result of its budgeted search.
+ */
+struct Outcome
+{
+  std::string_view engine{};
+  bool accepted{false};
+  GameState state{GameState::VIOLATION};
+  std::string solution{};
+};
+
+
+[[noreturn]] void fail(std::string_view puzzle, std::string_view what)
+{
+  fmt::print(stderr, "{}\npuzzle: '{}'\n", what, puzzle);
+  std::abort();
+}
+
+
+template <typename Engine, typename... Args>
+Outcome run_engine(std::string_view engine, std::string_view puzzle, std::uint64_t max_nodes, const Args&... args)
+{
+  Outcome outcome{engine};
+  try
+  {
+    Engine solver{puzzle, args...};
+    outcome.accepted = true;
+
+    Budget budget{};
+    budget.max_nodes = max_nodes;
+    outcome.state = solver.solve(budget);
+    if(outcome.state == GameState::SOLVED)
+    {
+      outcome.solution = solver.solution();
+    }
+  }
+  catch(const std::exception&)
+  {
+    // the puzzle is not a line of cells; every engine has to turn it down
+  }
+
+  return outcome;
+}
+
+
+/**
+ * Check that the solution is a full valid grid that keeps every clue.
+ */
+template <std::size_t Order>
+bool keeps_clues(std::string_view puzzle, std::string_view solution)
 {
-  constexpr auto scale = 1000;
+  if(solution.size() != Geometry<Order>::NUM_CELLS)
+  {
+    return false;
+  }
 
-  int value = 0;
-  for (std::size_t offset = 0; offset < Size; ++offset) {
-    value += static_cast<int>(*std::next(Data, static_cast<long>(offset))) * scale;
+  for(std::size_t i = 0; i < puzzle.size(); ++i)
+  {
+    auto clue = normalize_cell(puzzle[i]);
+    if(clue != EMPTY_CELL and clue != solution[i])
+    {
+      return false;
+    }
   }
-  return value;
+
+  return BasicSudokuSolver<Order>{solution}.get_game_state() == GameState::SOLVED;
 }
 
-// Fuzzer that attempts to invoke undefined behavior for signed integer overflow
+
+/**
+ * Solve the puzzle with every engine and fail unless they agree: all turn it
+ * down or none does, all find a solution or none does, every solution is
+ * valid, and a puzzle with a unique solution gets the same one everywhere.
+ */
+template <std::size_t Order>
+void cross_check(std::string_view puzzle)
+{
+  auto max_nodes = Order == 3 ? MAX_NODES : MAX_NODES_OTHER_SIZES;
+
+  std::vector<Outcome> outcomes{};
+  outcomes.push_back(run_engine<BasicSudokuSolver<Order>>("bitmask", puzzle, max_nodes));
+  outcomes.push_back(run_engine<BasicSudokuSolver<Order>>(
+    "bitmask with locked candidates", puzzle, max_nodes, Branching::MRV_DEGREE, Propagation::LOCKED_CANDIDATES));
+  outcomes.push_back(run_engine<BasicDlxSolver<Order>>("dlx", puzzle, max_nodes));
+  // plain backtracking in row order without propagation, which needs far more nodes and may run out on any grid
+  outcomes.push_back(run_engine<BasicSudokuSolver<Order>>(
+    "reference", puzzle, max_nodes, Branching::ROW_ORDER, Propagation::NONE));
+
+  const auto& first = outcomes.front();
+  for(const auto& outcome : outcomes)
+  {
+    if(outcome.accepted != first.accepted)
+    {
+      fail(puzzle, fmt::format("{} and {} disagree on whether the puzzle is valid", first.engine, outcome.engine));
+    }
+    else if(outcome.state == GameState::TIMED_OUT and Order == 3 and outcome.engine != "reference")
+    {
+      fail(puzzle, fmt::format("{} ran out of {} search nodes", outcome.engine, max_nodes));
+    }
+    else if(outcome.state == GameState::SOLVED and not keeps_clues<Order>(puzzle, outcome.solution))
+    {
+      fail(puzzle, fmt::format("{} found an invalid solution {}", outcome.engine, outcome.solution));
+    }
+  }
+
+  if(not first.accepted)
+  {
+    return;
+  }
+
+  std::vector<const Outcome*> settled{};
+  for(const auto& outcome : outcomes)
+  {
+    if(outcome.state != GameState::TIMED_OUT)
+    {
+      settled.push_back(&outcome);
+    }
+  }
+
+  for(const auto* outcome : settled)
+  {
+    if((outcome->state == GameState::SOLVED) != (settled.front()->state == GameState::SOLVED))
+    {
+      fail(puzzle, fmt::format("{} and {} disagree on whether the puzzle has a solution", settled.front()->engine, outcome->engine));
+    }
+  }
+
+  if(Order != 3 or first.state == GameState::TIMED_OUT)
+  {
+    return;
+  }
+
+  // a 9x9 search that settled within the budget is quick to repeat without one
+  auto count = BasicSudokuSolver<Order>{puzzle}.count_solutions(2);
+  if(BasicDlxSolver<Order>{puzzle}.count_solutions(2) != count)
+  {
+    fail(puzzle, "bitmask and dlx count different numbers of solutions");
+  }
+  else if((count != 0) != (first.state == GameState::SOLVED))
+  {
+    fail(puzzle, "the solution count disagrees with the search");
+  }
+
+  for(const auto* outcome : settled)
+  {
+    if(count == 1 and outcome->solution != first.solution)
+    {
+      fail(puzzle, fmt::format("{} and {} find different unique solutions", first.engine, outcome->engine));
+    }
+  }
+
+  // the lockstep propagation of the batch path and the rating work on the same candidates
+  std::vector<std::string_view> batch{puzzle};
+  std::string lines{};
+  solve_chunk<BasicSudokuSolver>(std::span<const std::string_view>{batch}, std::nullopt, lines);
+  auto expected = count ? first.solution : std::string{NO_SOLUTION};
+  if(count < 2 and lines != expected + '\n')
+  {
+    fail(puzzle, fmt::format("the batch path answers {}", lines));
+  }
+
+  auto rating = BasicSudokuSolver<Order>{puzzle}.rate();
+  if(rating.state == GameState::SOLVED ? count != 1 : (rating.state == GameState::VIOLATION and count != 0))
+  {
+    fail(puzzle, fmt::format("rating ends {} with {} solutions", static_cast<int>(rating.state), count));
+  }
+}
+
+
+// Fuzzer that feeds arbitrary bytes to every engine as a puzzle and checks that they agree on the answer
 // cppcheck-suppress unusedFunction symbolName=LLVMFuzzerTestOneInput
-extern "C" int LLVMFuzzerTestOneInput(const uint8_t *Data, size_t Size)
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *Data, std::size_t Size)
 {
-  fmt::print("Value sum: {}, len{}\n", sum_values(Data,Size), Size);
+  std::string_view puzzle{reinterpret_cast<const char*>(Data), Size};
+
+  // like the front end, lines of a length no other grid has are 9x9 puzzles
+  with_order(order_for_cells(puzzle.size()), [&]<std::size_t Order>() { cross_check<Order>(puzzle); });
   return 0;
 }
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+
+/**
+ * Bump allocator for the memory of one puzzle's search. Allocations are cut
+ * from large blocks one after another; deallocating does nothing, the memory
+ * comes back all at once when the arena is rewound. The blocks stay with the
+ * arena, so once it has grown to fit the biggest search no puzzle after that
+ * touches the global heap. An arena belongs to one thread and isn't
+ * synchronized.
+ */
+class Arena final : public std::pmr::memory_resource
+{
+public: /** ============================= TYPES ============================= **/
+  /**
+   * A point in the arena to rewind to, from mark().
+   */
+  struct Mark
+  {
+    std::size_t block{0};
+    std::size_t used{0};
+  };
+
+private: /** ============================= TYPES ============================= **/
+  struct Block
+  {
+    void* data;
+    std::size_t size;
+  };
+
+  static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::pmr::memory_resource* upstream_;
+  std::vector<Block> blocks_{};
+  // the block allocations are cut from, and how much of it is taken
+  Mark top_{};
+
+protected: /** ============================= MEMBER METHODS ============================= **/
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    for(;; ++top_.block, top_.used = 0)
+    {
+      if(top_.block == blocks_.size())
+      {
+        auto size = std::max(BLOCK_SIZE, bytes + alignment);
+        blocks_.push_back({upstream_->allocate(size, alignof(std::max_align_t)), size});
+      }
+
+      auto& block = blocks_[top_.block];
+      void* address = static_cast<std::byte*>(block.data) + top_.used;
+      auto space = block.size - top_.used;
+      if(std::align(alignment, bytes, address, space))
+      {
+        top_.used = block.size - space + bytes;
+        return address;
+      }
+    }
+  }
+
+  void do_deallocate(void*, std::size_t, std::size_t) override
+  {}
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit Arena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+    : upstream_{upstream}
+  {}
+
+  ~Arena() override
+  {
+    for(auto block : blocks_)
+    {
+      upstream_->deallocate(block.data, block.size, alignof(std::max_align_t));
+    }
+  }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  Mark mark() const
+  {
+    return top_;
+  }
+
+  /**
+   * Hand back everything allocated since the mark was taken. Nothing
+   * allocated after it may be used any more.
+   */
+  void rewind(Mark mark)
+  {
+    top_ = mark;
+  }
+
+  void reset()
+  {
+    rewind({});
+  }
+
+  /**
+   * Bytes the arena holds on to, used or not.
+   */
+  std::size_t capacity() const
+  {
+    std::size_t size = 0;
+    for(auto block : blocks_)
+    {
+      size += block.size;
+    }
+
+    return size;
+  }
+};
+
+
+/**
+ * The calling thread's arena.
+ */
+inline Arena& thread_arena()
+{
+  thread_local Arena arena{};
+  return arena;
+}
+
+
+/**
+ * Rewinds the arena to where it was when the scope was opened. Open it before
+ * constructing anything that allocates from the arena, so that those objects
+ * are gone by the time it closes.
+ */
+class ArenaScope
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  Arena& arena_;
+  Arena::Mark mark_;
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit ArenaScope(Arena& arena)
+    : arena_{arena}, mark_{arena.mark()}
+  {}
+
+  ~ArenaScope()
+  {
+    arena_.rewind(mark_);
+  }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+  Arena& arena()
+  {
+    return arena_;
+  }
+};
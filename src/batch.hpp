@@ -0,0 +1,490 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "arena.hpp"
+#include "canonical_form.hpp"
+#include "lane_solver.hpp"
+#include "lru_cache.hpp"
+#include "packed_format.hpp"
+#include "solver.hpp"
+
+
+static constexpr char NO_SOLUTION[] = "Failed to find solution";
+
+/**
+ * Solutions of 9x9 puzzles in canonical form, an empty one for puzzles
+ * without solution.
+ */
+using SolutionCache = ShardedLruCache<std::string, std::string>;
+
+// Searches that settle within this many nodes cost less than finding the
+// canonical form of the puzzle, so they don't go through the cache.
+static constexpr std::uint64_t CACHE_MIN_NODES = 64;
+
+// Puzzles handed to a worker at a time. Big enough to keep the shared counter
+// cold, small enough to balance hard puzzles across the pool.
+static constexpr std::size_t BATCH_CHUNK_SIZE = 256;
+
+
+/**
+ * Append the solver's answer line to out: the solution, or given a count
+ * limit the number of solutions up to that limit.
+ */
+template <typename Engine>
+void write_answer(Engine& solver, std::optional<std::size_t> count, std::string& out)
+{
+  if(count)
+  {
+    fmt::format_to(std::back_inserter(out), "{}", solver.count_solutions(*count));
+  }
+  else if(solver.solve())
+  {
+    out.append(solver.solution());
+  }
+  else
+  {
+    out.append(NO_SOLUTION);
+  }
+  out.push_back('\n');
+}
+
+
+/**
+ * Append the answer line for the puzzle to out, worked out by the engine for
+ * its grid size. Any further arguments go to the engine's constructor.
+ */
+template <template <std::size_t> class Engine, typename... Args>
+void answer_into(std::string_view puzzle, std::optional<std::size_t> count, std::string& out, const Args&... args)
+{
+  with_solver<Engine>(
+    puzzle, [&](auto& solver) { write_answer(solver, count, out); }, args...);
+}
+
+
+/**
+ * Solve the puzzle with the engine for its grid size and append its solution
+ * line to out.
+ */
+template <template <std::size_t> class Engine, typename... Args>
+void solve_into(std::string_view puzzle, std::string& out, const Args&... args)
+{
+  answer_into<Engine>(puzzle, std::nullopt, out, args...);
+}
+
+
+/**
+ * Append the solution line for the 9x9 puzzle to out like solve_into(). A
+ * puzzle the search doesn't settle within CACHE_MIN_NODES is only solved if
+ * no symmetric variant of it is in the cache yet, and puzzles without a
+ * canonical form are solved as they are. A puzzle with several solutions may
+ * get another one from the cache than its own search would find.
+ */
+template <template <std::size_t> class Engine, typename... Args>
+void answer_cached(const Board& puzzle, SolutionCache& cache, std::string& out, const Args&... args)
+{
+  constexpr auto NUM_CELLS = Geometry<3>::NUM_CELLS;
+
+  Engine<3> solver{puzzle, args...};
+  Budget quick{};
+  quick.max_nodes = CACHE_MIN_NODES;
+  if(auto state = solver.solve(quick); state != GameState::TIMED_OUT)
+  {
+    out.append(state == GameState::SOLVED ? solver.solution() : std::string_view{NO_SOLUTION});
+    out.push_back('\n');
+    return;
+  }
+
+  auto canonical = canonicalize(puzzle);
+  if(not canonical)
+  {
+    write_answer(solver, std::nullopt, out);
+    return;
+  }
+
+  auto solution = cache.get(canonical->form);
+  if(not solution)
+  {
+    Engine<3> canonical_solver{canonical->form, args...};
+    solution = canonical_solver.solve() ? std::string{canonical_solver.solution()} : std::string{};
+    cache.put(canonical->form, *solution);
+  }
+
+  if(solution->empty())
+  {
+    out.append(NO_SOLUTION);
+  }
+  else
+  {
+    auto start = out.size();
+    out.resize(start + NUM_CELLS);
+    canonical->symmetry.revert(*solution, out.data() + start);
+  }
+  out.push_back('\n');
+}
+
+
+#ifdef SUDOKU_HAS_LANES
+/**
+ * Solve the puzzles with the backtracking engine, running singles propagation
+ * for groups of 9x9 puzzles in lockstep first. Only the puzzles propagation
+ * neither solves nor refutes go through the scalar search, which starts from
+ * the propagated grid and so finds the same solution it would have found from
+ * the puzzle. A puzzle propagation solves has no other solution, which makes
+ * counting as cheap as solving for it. Puzzles of other sizes are solved one
+ * by one. Solvers take their memory from the thread's arena. Given a cache,
+ * the grids left to the scalar search are looked up in it first; as
+ * propagation commutes with the symmetries, variants of a puzzle leave
+ * variants of the same grid. Boards go into the lanes as they are.
+ */
+template <typename Puzzle>
+void solve_lanes(std::span<const Puzzle> puzzles,
+  std::optional<std::size_t> count,
+  std::string& out,
+  SolutionCache* cache = nullptr)
+{
+  using Shape = Geometry<3>;
+
+  ArenaScope scope{thread_arena()};
+  LanePropagator lanes{};
+  std::size_t group_size = 0;
+  // reloaded for every puzzle the lanes leave open
+  BasicSudokuSolver<3> solver{Board{}, Branching::MRV, Propagation::SINGLES, &scope.arena()};
+
+  auto flush_group = [&]() {
+    lanes.propagate();
+    for(std::size_t lane = 0; lane < group_size; ++lane)
+    {
+      Board grid{lanes.cells(lane)};
+      if(lanes.failed(lane) or lanes.solved(lane))
+      {
+        bool solved = lanes.solved(lane);
+        if(count)
+        {
+          fmt::format_to(std::back_inserter(out), "{}", std::min<std::size_t>(solved, *count));
+        }
+        else
+        {
+          out.append(solved ? grid.view() : std::string_view{NO_SOLUTION});
+        }
+        out.push_back('\n');
+      }
+      else if(cache and not count)
+      {
+        ArenaScope puzzle_scope{scope.arena()};
+        answer_cached<BasicSudokuSolver>(grid, *cache, out, &puzzle_scope.arena());
+      }
+      else
+      {
+        solver.load(grid);
+        write_answer(solver, count, out);
+      }
+    }
+
+    lanes = LanePropagator{};
+    group_size = 0;
+  };
+
+  for(const auto& puzzle : puzzles)
+  {
+    if constexpr(std::is_same_v<Puzzle, Board>)
+    {
+      lanes.load(group_size++, puzzle);
+    }
+    else
+    {
+      std::string_view view{puzzle};
+      if(view.size() != Shape::NUM_CELLS)
+      {
+        if(group_size)
+        {
+          flush_group();
+        }
+        ArenaScope puzzle_scope{scope.arena()};
+        answer_into<BasicSudokuSolver>(view, count, out, &puzzle_scope.arena());
+        continue;
+      }
+
+      lanes.load(group_size++, view);
+    }
+    if(group_size == LanePropagator::LANES)
+    {
+      flush_group();
+    }
+  }
+
+  if(group_size)
+  {
+    flush_group();
+  }
+}
+#endif
+
+
+/**
+ * Work out a run of puzzles, appending an answer line per puzzle to out. Each
+ * puzzle's solver allocates from the thread's arena, which is rewound after
+ * it, so once the arena has grown to fit the biggest search the puzzles make
+ * no heap allocations of their own. A cache, if given, answers the 9x9
+ * puzzles it has seen a variant of; it is left out when counting.
+ */
+template <template <std::size_t> class Engine, typename Puzzle>
+void solve_chunk(std::span<const Puzzle> puzzles,
+  std::optional<std::size_t> count,
+  std::string& out,
+  SolutionCache* cache = nullptr)
+{
+#ifdef SUDOKU_HAS_LANES
+  if constexpr(std::is_same_v<Engine<3>, BasicSudokuSolver<3>>)
+  {
+    solve_lanes(puzzles, count, out, cache);
+    return;
+  }
+#endif
+
+  for(const auto& puzzle : puzzles)
+  {
+    ArenaScope scope{thread_arena()};
+    std::string_view view{puzzle};
+    if(cache and not count and view.size() == Geometry<3>::NUM_CELLS)
+    {
+      answer_cached<Engine>(Board{view}, *cache, out, &scope.arena());
+    }
+    else
+    {
+      answer_into<Engine>(view, count, out, &scope.arena());
+    }
+  }
+}
+
+
+/**
+ * Like solve_chunk() for boards, which the engines load without checking
+ * their cells again.
+ */
+template <template <std::size_t> class Engine, std::size_t Order>
+void solve_chunk(std::span<const BasicBoard<Order>> boards,
+  std::optional<std::size_t> count,
+  std::string& out,
+  SolutionCache* cache = nullptr)
+{
+#ifdef SUDOKU_HAS_LANES
+  if constexpr(Order == 3 and std::is_same_v<Engine<3>, BasicSudokuSolver<3>>)
+  {
+    solve_lanes(boards, count, out, cache);
+    return;
+  }
+#endif
+
+  for(const auto& board : boards)
+  {
+    ArenaScope scope{thread_arena()};
+    if constexpr(Order == 3)
+    {
+      if(cache and not count)
+      {
+        answer_cached<Engine>(board, *cache, out, &scope.arena());
+        continue;
+      }
+    }
+
+    Engine<Order> solver{board, &scope.arena()};
+    write_answer(solver, count, out);
+  }
+}
+
+
+/**
+ * Call fn(i) for every i below num_tasks on num_threads workers, the calling
+ * thread among them. Workers claim tasks one at a time from a shared counter.
+ * An exception thrown by any worker is rethrown here once all workers have
+ * stopped.
+ */
+template <typename Fn>
+void run_tasks(std::size_t num_tasks, std::size_t num_threads, Fn&& fn)
+{
+  std::atomic<std::size_t> next_task{0};
+  std::exception_ptr error{};
+  std::mutex error_mutex{};
+
+  auto worker = [&]() {
+    try
+    {
+      for(auto i = next_task++; i < num_tasks; i = next_task++)
+      {
+        fn(i);
+      }
+    }
+    catch(...)
+    {
+      // stop handing out work and report the first failure
+      next_task = num_tasks;
+      std::lock_guard lock{error_mutex};
+      if(not error)
+      {
+        error = std::current_exception();
+      }
+    }
+  };
+
+  num_threads = std::clamp<std::size_t>(num_threads, 1, std::max<std::size_t>(num_tasks, 1));
+  std::vector<std::thread> pool{};
+  pool.reserve(num_threads - 1);
+  for(std::size_t t = 1; t < num_threads; ++t)
+  {
+    pool.emplace_back(worker);
+  }
+
+  // the calling thread is one of the workers
+  worker();
+  for(auto& thread : pool)
+  {
+    thread.join();
+  }
+
+  if(error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+
+/**
+ * Call fn(i, chunks[i]) for every one of num_chunks output chunks on
+ * num_threads workers like run_tasks().
+ */
+template <typename Fn>
+void run_chunks(std::size_t num_chunks, std::size_t num_threads, std::vector<std::string>& chunks, Fn&& fn)
+{
+  chunks.resize(num_chunks);
+  run_tasks(num_chunks, num_threads, [&](std::size_t i) {
+    auto& out = chunks[i];
+    out.clear();
+    fn(i, out);
+  });
+}
+
+
+/**
+ * Solve the puzzles on num_threads workers. The puzzles are split into chunks
+ * of BATCH_CHUNK_SIZE; the solution lines of chunk i end up in chunks[i], so
+ * writing the chunks out one after another keeps the input order. An exception
+ * thrown by any worker is rethrown here once all workers have stopped. Given a
+ * count limit, the lines hold the number of solutions instead. All workers
+ * share the cache, if there is one.
+ */
+template <template <std::size_t> class Engine, typename Puzzle>
+void solve_batch(std::span<const Puzzle> puzzles,
+  std::size_t num_threads,
+  std::vector<std::string>& chunks,
+  std::optional<std::size_t> count = std::nullopt,
+  SolutionCache* cache = nullptr)
+{
+  auto num_chunks = (puzzles.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+  run_chunks(num_chunks, num_threads, chunks, [&](std::size_t i, std::string& out) {
+    auto first = i * BATCH_CHUNK_SIZE;
+    auto last = std::min(first + BATCH_CHUNK_SIZE, puzzles.size());
+    solve_chunk<Engine>(puzzles.subspan(first, last - first), count, out, cache);
+  });
+}
+
+
+/**
+ * Like solve_batch() with the backtracking engine, also keeping what the search
+ * did for puzzle number k in stats[k]. The puzzles skip the lockstep
+ * propagation so that each of them is measured on its own.
+ */
+template <typename Puzzle>
+void solve_batch_stats(std::span<const Puzzle> puzzles,
+  std::size_t num_threads,
+  std::vector<std::string>& chunks,
+  std::optional<std::size_t> count,
+  std::vector<SearchStats>& stats)
+{
+  stats.assign(puzzles.size(), SearchStats{});
+
+  auto num_chunks = (puzzles.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+  run_chunks(num_chunks, num_threads, chunks, [&](std::size_t i, std::string& out) {
+    auto last = std::min((i + 1) * BATCH_CHUNK_SIZE, puzzles.size());
+    for(auto k = i * BATCH_CHUNK_SIZE; k < last; ++k)
+    {
+      with_solver<InstrumentedSolver>(std::string_view{puzzles[k]}, [&](auto& solver) {
+        write_answer(solver, count, out);
+        stats[k] = solver.stats();
+      });
+    }
+  });
+}
+
+
+/**
+ * Rate the puzzles on num_threads workers like solve_batch() solves them,
+ * with a line per puzzle: the score and the hardest technique the puzzle
+ * needs, or NO_SOLUTION if the techniques show it has none.
+ */
+template <typename Puzzle>
+void rate_batch(std::span<const Puzzle> puzzles, std::size_t num_threads, std::vector<std::string>& chunks)
+{
+  auto num_chunks = (puzzles.size() + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+  run_chunks(num_chunks, num_threads, chunks, [&](std::size_t i, std::string& out) {
+    auto last = std::min((i + 1) * BATCH_CHUNK_SIZE, puzzles.size());
+    for(auto k = i * BATCH_CHUNK_SIZE; k < last; ++k)
+    {
+      ArenaScope scope{thread_arena()};
+      auto rating = with_solver<BasicSudokuSolver>(std::string_view{puzzles[k]}, [](auto& solver) { return solver.rate(); }, &scope.arena());
+      if(rating.state == GameState::SOLVED or rating.state == GameState::VALID)
+      {
+        fmt::format_to(std::back_inserter(out), "{} {}\n", rating.score, technique_name(rating.hardest));
+      }
+      else
+      {
+        out.append(NO_SOLUTION);
+        out.push_back('\n');
+      }
+    }
+  });
+}
+
+
+/**
+ * Like solve_batch() for the packed puzzles first to first + size - 1. Every
+ * worker decodes its own chunks into boards, so decoding runs in parallel as
+ * well, and the engines load the boards without parsing their cells again.
+ */
+template <template <std::size_t> class Engine>
+void solve_packed_batch(const PackedPuzzles& packed,
+  std::size_t first,
+  std::size_t size,
+  std::size_t num_threads,
+  std::vector<std::string>& chunks,
+  std::optional<std::size_t> count = std::nullopt,
+  SolutionCache* cache = nullptr)
+{
+  with_order(packed.order, [&]<std::size_t Order>() {
+    auto num_chunks = (size + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+    run_chunks(num_chunks, num_threads, chunks, [&](std::size_t i, std::string& out) {
+      std::vector<BasicBoard<Order>> boards{};
+      auto begin = first + i * BATCH_CHUNK_SIZE;
+      auto end = std::min(begin + BATCH_CHUNK_SIZE, first + size);
+      boards.reserve(end - begin);
+      for(auto k = begin; k < end; ++k)
+      {
+        boards.push_back(unpack_board<Order>(packed.record(k)));
+      }
+      solve_chunk<Engine>(std::span<const BasicBoard<Order>>{boards}, count, out, cache);
+    });
+  });
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+#include "grid.hpp"
+
+
+/**
+ * The cells of a puzzle, checked once when the board is made. A board is
+ * plain data, NUM_CELLS characters, so it is as cheap to copy as the array
+ * behind it, and solvers load it without checking it again.
+ */
+template <std::size_t Order>
+class BasicBoard
+{
+public: /** ============================= TYPES ============================= **/
+  using Shape = Geometry<Order>;
+
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  grid<char, SIZE> cells_{};
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * A board with every cell empty.
+   */
+  BasicBoard()
+  {
+    cells_.fill(EMPTY_CELL);
+  }
+
+  /**
+   * The puzzle as a line of cells; missing trailing cells are empty. Throws on
+   * too many cells and on characters that are neither digits nor empty cells.
+   */
+  explicit BasicBoard(std::string_view puzzle)
+  {
+    if(puzzle.size() > NUM_CELLS)
+    {
+      throw std::range_error("Too many digits in the puzzle");
+    }
+
+    cells_.fill(EMPTY_CELL);
+    std::transform(puzzle.begin(), puzzle.end(), cells_.begin(), parse_cell<Order>);
+  }
+
+  /**
+   * Cells that were checked already, such as the ones a packed record decodes
+   * to: digits of the grid or EMPTY_CELL. They are taken as they are.
+   */
+  explicit BasicBoard(const grid<char, SIZE>& cells)
+    : cells_{cells}
+  {}
+
+  const grid<char, SIZE>& cells() const
+  {
+    return cells_;
+  }
+
+  /**
+   * The board as a line of NUM_CELLS cells.
+   */
+  std::string_view view() const
+  {
+    return {cells_.data(), cells_.size()};
+  }
+
+  char at(std::size_t x, std::size_t y) const
+  {
+    check_cell(x, y, cells_);
+    return get_cell(x, y, cells_);
+  }
+
+  /**
+   * Put a digit or an empty cell into the cell; throws like the constructor.
+   */
+  void set(std::size_t x, std::size_t y, char value)
+  {
+    check_cell(x, y, cells_);
+    get_cell(x, y, cells_) = parse_cell<Order>(value);
+  }
+
+  std::size_t num_clues() const
+  {
+    return NUM_CELLS - static_cast<std::size_t>(std::count(cells_.begin(), cells_.end(), EMPTY_CELL));
+  }
+
+  bool operator==(const BasicBoard&) const = default;
+};
+
+
+using Board = BasicBoard<3>;
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+
+/**
+ * Fixed capacity lock-free queue for any number of producers and consumers,
+ * after Dmitry Vyukov's bounded MPMC queue. Every slot carries a sequence
+ * number that tells producers and consumers whose turn it is, so a push or pop
+ * costs one compare-and-swap on the shared position plus one store. With a
+ * single producer and a single consumer the CAS never fails and the queue
+ * behaves as an SPSC ring.
+ *
+ * The blocking push() and pop() spin, then yield, then sleep briefly while
+ * they wait, which keeps idle stages off the CPU. close() ends the stream:
+ * pushes fail from then on and pops fail once the queue is drained.
+ */
+template <typename T>
+class BoundedQueue
+{
+private: /** ============================= TYPES ============================= **/
+  struct Slot
+  {
+    std::atomic<std::size_t> sequence{0};
+    T value{};
+  };
+
+  // keeps the producer and consumer positions on separate cache lines
+  static constexpr std::size_t CACHE_LINE = 64;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_;
+  alignas(CACHE_LINE) std::atomic<std::size_t> push_pos_{0};
+  alignas(CACHE_LINE) std::atomic<std::size_t> pop_pos_{0};
+  alignas(CACHE_LINE) std::atomic<bool> closed_{false};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  static void back_off(std::size_t& attempts)
+  {
+    if(++attempts < 64)
+    {
+      return;
+    }
+    else if(attempts < 128)
+    {
+      std::this_thread::yield();
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds{50});
+    }
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * Room for capacity entries, rounded up to a power of two.
+   */
+  explicit BoundedQueue(std::size_t capacity)
+    : slots_{std::make_unique<Slot[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))},
+      mask_{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1}
+  {
+    for(std::size_t i = 0; i <= mask_; ++i)
+    {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  std::size_t capacity() const
+  {
+    return mask_ + 1;
+  }
+
+  /**
+   * Move value into the queue unless it is full. Returns false, leaving value
+   * alone, if it is.
+   */
+  bool try_push(T& value)
+  {
+    auto pos = push_pos_.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      auto& slot = slots_[pos & mask_];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      if(sequence == pos)
+      {
+        if(push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          slot.value = std::move(value);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(sequence < pos)
+      {
+        // the consumer of the previous round hasn't freed the slot yet
+        return false;
+      }
+      else
+      {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Move the oldest entry into value unless the queue is empty.
+   */
+  bool try_pop(T& value)
+  {
+    auto pos = pop_pos_.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      auto& slot = slots_[pos & mask_];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      if(sequence == pos + 1)
+      {
+        if(pop_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          value = std::move(slot.value);
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(sequence < pos + 1)
+      {
+        return false;
+      }
+      else
+      {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * Wait for room and push value. Returns false if the queue was closed.
+   */
+  bool push(T value)
+  {
+    for(std::size_t attempts = 0; not closed_.load(std::memory_order_acquire); back_off(attempts))
+    {
+      if(try_push(value))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Wait for an entry and move it into value. Returns false once the queue is
+   * closed and empty.
+   */
+  bool pop(T& value)
+  {
+    for(std::size_t attempts = 0;; back_off(attempts))
+    {
+      if(try_pop(value))
+      {
+        return true;
+      }
+      else if(closed_.load(std::memory_order_acquire))
+      {
+        // entries pushed before the close are still handed out
+        return try_pop(value);
+      }
+    }
+  }
+
+  void close()
+  {
+    closed_.store(true, std::memory_order_release);
+  }
+};
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "board.hpp"
+#include "grid.hpp"
+
+
+/**
+ * One of the transformations of a 9x9 grid that keep it a sudoku: an optional
+ * transposition, then a permutation of the rows that keeps the bands together
+ * and of the columns that keeps the stacks together, then a relabeling of the
+ * digits. The solutions of the transformed puzzle are the transformed
+ * solutions of the puzzle.
+ */
+struct Symmetry
+{
+  using Shape = Geometry<3>;
+
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+
+  bool transpose{false};
+  // row r of the result is row rows[r] of the (transposed) grid, likewise for columns
+  std::array<std::uint8_t, SIZE> rows{};
+  std::array<std::uint8_t, SIZE> cols{};
+  // digit i + 1 of the grid becomes digits[i]
+  std::array<char, SIZE> digits{};
+
+  std::size_t source_cell(std::size_t row, std::size_t col) const
+  {
+    return transpose ? cols[col] * SIZE + rows[row] : rows[row] * SIZE + cols[col];
+  }
+
+  /**
+   * Write the NUM_CELLS cells of the transformed grid to out.
+   */
+  void apply(std::string_view grid, char* out) const
+  {
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto value = grid[source_cell(cell / SIZE, cell % SIZE)];
+      out[cell] = value == EMPTY_CELL ? EMPTY_CELL : digits[digit_to_idx(value)];
+    }
+  }
+
+  /**
+   * The inverse of apply(): write the NUM_CELLS cells of the grid that
+   * transforms into the given one to out.
+   */
+  void revert(std::string_view grid, char* out) const
+  {
+    std::array<char, SIZE> original{};
+    for(std::size_t digit = 0; digit < SIZE; ++digit)
+    {
+      original[digit_to_idx(digits[digit])] = DIGITS[digit];
+    }
+
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto value = grid[cell];
+      out[source_cell(cell / SIZE, cell % SIZE)] = value == EMPTY_CELL ? EMPTY_CELL : original[digit_to_idx(value)];
+    }
+  }
+};
+
+
+/**
+ * A puzzle in canonical form, and the symmetry that takes the puzzle there.
+ */
+struct CanonicalForm
+{
+  std::string form{};
+  Symmetry symmetry{};
+};
+
+
+namespace detail {
+/**
+ * All 1296 column orders that keep the stacks together, and for each pattern
+ * of filled cells in a row the orders that move the filled cells furthest to
+ * the right. Patterns are 9 bit masks, column 0 in the highest bit.
+ */
+struct ColumnOrders
+{
+  using Shape = Geometry<3>;
+
+  static constexpr std::size_t NUM_PATTERNS = std::size_t{1} << Shape::SIZE;
+
+  std::vector<std::array<std::uint8_t, Shape::SIZE>> orders{};
+  // the orders best for pattern p are best[begin[p]] to best[begin[p + 1] - 1]
+  std::vector<std::uint16_t> best{};
+  std::array<std::uint32_t, NUM_PATTERNS + 1> begin{};
+  std::array<std::uint16_t, NUM_PATTERNS> best_pattern{};
+
+  ColumnOrders()
+  {
+    std::array<std::uint8_t, Shape::ORDER> stacks{};
+    std::iota(stacks.begin(), stacks.end(), std::uint8_t{0});
+    do
+    {
+      std::array<std::array<std::uint8_t, Shape::ORDER>, Shape::ORDER> within{};
+      add_orders(stacks, within, 0);
+    } while(std::next_permutation(stacks.begin(), stacks.end()));
+
+    std::vector<std::uint16_t> permuted(orders.size());
+    for(std::size_t pattern = 0; pattern < NUM_PATTERNS; ++pattern)
+    {
+      for(std::size_t i = 0; i < orders.size(); ++i)
+      {
+        std::uint16_t bits = 0;
+        for(auto col : orders[i])
+        {
+          bits = static_cast<std::uint16_t>(std::size_t{bits} << 1 | (pattern >> (Shape::SIZE - 1 - col) & 1));
+        }
+        permuted[i] = bits;
+      }
+
+      best_pattern[pattern] = *std::min_element(permuted.begin(), permuted.end());
+      begin[pattern] = static_cast<std::uint32_t>(best.size());
+      for(std::size_t i = 0; i < orders.size(); ++i)
+      {
+        if(permuted[i] == best_pattern[pattern])
+        {
+          best.push_back(static_cast<std::uint16_t>(i));
+        }
+      }
+    }
+    begin[NUM_PATTERNS] = static_cast<std::uint32_t>(best.size());
+  }
+
+private:
+  void add_orders(const std::array<std::uint8_t, Shape::ORDER>& stacks,
+    std::array<std::array<std::uint8_t, Shape::ORDER>, Shape::ORDER>& within,
+    std::size_t stack)
+  {
+    if(stack == Shape::ORDER)
+    {
+      auto& order = orders.emplace_back();
+      for(std::size_t i = 0; i < Shape::SIZE; ++i)
+      {
+        order[i] = static_cast<std::uint8_t>(stacks[i / Shape::ORDER] * Shape::ORDER + within[i / Shape::ORDER][i % Shape::ORDER]);
+      }
+      return;
+    }
+
+    auto& cols = within[stack];
+    std::iota(cols.begin(), cols.end(), std::uint8_t{0});
+    do
+    {
+      add_orders(stacks, within, stack + 1);
+    } while(std::next_permutation(cols.begin(), cols.end()));
+  }
+};
+
+
+inline const ColumnOrders& column_orders()
+{
+  static const ColumnOrders orders{};
+  return orders;
+}
+}// namespace detail
+
+
+/**
+ * The canonical form of a 9x9 puzzle: of all the grids its symmetries make
+ * of it, the one that comes first as a line of cells, empty cells before
+ * digits. Symmetric variants of a puzzle, relabeled, transposed or with rows
+ * and columns swapped within bands and stacks, share their canonical form.
+ *
+ * The rows of the result are fixed one after another, keeping every partial
+ * symmetry that gives the smallest rows so far. Grids with so many symmetries
+ * that more than MAX_CANDIDATES of them stay in the running, such as nearly
+ * empty ones, have no canonical form here.
+ */
+inline std::optional<CanonicalForm> canonicalize(const Board& board)
+{
+  using Shape = Geometry<3>;
+  constexpr auto SIZE = Shape::SIZE;
+  constexpr auto ORDER = Shape::ORDER;
+  constexpr std::size_t MAX_CANDIDATES = std::size_t{1} << 16;
+
+  struct Candidate
+  {
+    Symmetry symmetry{};
+    std::size_t next_label{0};
+  };
+  using Row = std::array<char, SIZE>;
+
+  const auto& cells = board.cells();
+  std::array<grid<char, SIZE>, 2> grids{cells, cells};
+  for(std::size_t row = 0; row < SIZE; ++row)
+  {
+    for(std::size_t col = 0; col < SIZE; ++col)
+    {
+      grids[1][col * SIZE + row] = cells[row * SIZE + col];
+    }
+  }
+
+  std::vector<Candidate> candidates{};
+  std::vector<Candidate> next{};
+  Row best{};
+
+  // label row `row` of the result with source row `source`; keep the candidate if the row is no worse than the best
+  auto offer = [&](const Candidate& from, std::size_t row, std::size_t source) {
+    const auto* cells_in = grids[from.symmetry.transpose].data() + source * SIZE;
+    auto digits = from.symmetry.digits;
+    auto next_label = from.next_label;
+
+    Row labels{};
+    bool smaller = next.empty();
+    for(std::size_t col = 0; col < SIZE; ++col)
+    {
+      auto value = cells_in[from.symmetry.cols[col]];
+      if(value != EMPTY_CELL)
+      {
+        auto& label = digits[digit_to_idx(value)];
+        if(not label)
+        {
+          label = DIGITS[next_label++];
+        }
+        value = label;
+      }
+      labels[col] = value;
+
+      if(not smaller and value != best[col])
+      {
+        if(value > best[col])
+        {
+          return;
+        }
+        smaller = true;
+      }
+    }
+
+    if(smaller)
+    {
+      next.clear();
+      best = labels;
+    }
+
+    auto& candidate = next.emplace_back(from);
+    candidate.symmetry.rows[row] = static_cast<std::uint8_t>(source);
+    candidate.symmetry.digits = digits;
+    candidate.next_label = next_label;
+  };
+
+  // the first row only depends on which cells are filled, which the table answers
+  const auto& orders = detail::column_orders();
+  auto pattern_of = [&](std::size_t transpose, std::size_t row) {
+    std::size_t pattern = 0;
+    for(std::size_t col = 0; col < SIZE; ++col)
+    {
+      pattern = pattern << 1 | (grids[transpose][row * SIZE + col] != EMPTY_CELL);
+    }
+    return pattern;
+  };
+
+  std::size_t best_pattern = SIZE_MAX;
+  for(std::size_t transpose = 0; transpose < 2; ++transpose)
+  {
+    for(std::size_t row = 0; row < SIZE; ++row)
+    {
+      best_pattern = std::min<std::size_t>(best_pattern, orders.best_pattern[pattern_of(transpose, row)]);
+    }
+  }
+
+  for(std::size_t transpose = 0; transpose < 2; ++transpose)
+  {
+    for(std::size_t row = 0; row < SIZE; ++row)
+    {
+      auto pattern = pattern_of(transpose, row);
+      if(orders.best_pattern[pattern] != best_pattern)
+      {
+        continue;
+      }
+
+      Candidate start{};
+      start.symmetry.transpose = transpose;
+      for(auto i = orders.begin[pattern]; i < orders.begin[pattern + 1]; ++i)
+      {
+        start.symmetry.cols = orders.orders[orders.best[i]];
+        offer(start, 0, row);
+      }
+    }
+  }
+
+  for(std::size_t row = 1; row < SIZE; ++row)
+  {
+    if(next.size() > MAX_CANDIDATES)
+    {
+      return std::nullopt;
+    }
+
+    std::swap(candidates, next);
+    next.clear();
+    for(const auto& candidate : candidates)
+    {
+      const auto& rows = candidate.symmetry.rows;
+      auto used = std::span{rows}.first(row);
+      auto is_used = [&](std::size_t source) {
+        return std::find(used.begin(), used.end(), source) != used.end();
+      };
+      auto band_used = [&](std::size_t band) {
+        return std::any_of(used.begin(), used.end(), [&](auto source) { return source / ORDER == band; });
+      };
+
+      // a new band may be any unused one, otherwise the band goes on
+      for(std::size_t band = 0; band < ORDER; ++band)
+      {
+        if(row % ORDER ? band != rows[row - 1] / ORDER : band_used(band))
+        {
+          continue;
+        }
+
+        for(auto source = band * ORDER; source < (band + 1) * ORDER; ++source)
+        {
+          if(not is_used(source))
+          {
+            offer(candidate, row, source);
+          }
+        }
+      }
+    }
+  }
+
+  // digits the puzzle lacks get the labels left over
+  auto symmetry = next.front().symmetry;
+  auto next_label = next.front().next_label;
+  for(auto& label : symmetry.digits)
+  {
+    if(not label)
+    {
+      label = DIGITS[next_label++];
+    }
+  }
+
+  CanonicalForm canonical{std::string(Shape::NUM_CELLS, EMPTY_CELL), symmetry};
+  symmetry.apply(board.view(), canonical.form.data());
+  return canonical;
+}
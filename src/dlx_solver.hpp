@@ -0,0 +1,341 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "board.hpp"
+#include "grid.hpp"
+#include "search_budget.hpp"
+
+
+/**
+ * Knuth's Algorithm X with Dancing Links.
+ *
+ * The puzzle is an exact-cover problem with 4 * NUM_CELLS columns - every cell
+ * holds one digit, and every row, column and box holds every digit once - and
+ * one row per (cell, digit) placement: 324 columns and 729 rows for 9x9. All
+ * nodes live in a single vector that is sized once in the constructor and
+ * linked by index, allocated from the memory resource the solver is given.
+ */
+template <std::size_t Order>
+class BasicDlxSolver
+{
+private: /** ============================= TYPES ============================= **/
+  using Shape = Geometry<Order>;
+
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+
+  static constexpr size_t NUM_COLUMNS = 4 * NUM_CELLS;
+  static constexpr size_t NUM_ROWS = NUM_CELLS * SIZE;
+  static constexpr size_t ROOT = 0;
+  // the root, one header per column and four nodes per placement
+  static constexpr size_t NUM_NODES = 1 + NUM_COLUMNS + 4 * NUM_ROWS;
+
+  using index_t = uint_least_t<std::bit_width(NUM_NODES)>;
+
+  struct Node
+  {
+    index_t left;
+    index_t right;
+    index_t up;
+    index_t down;
+    index_t column; // header node of the column the node belongs to
+    index_t row;    // placement the node stands for: (x * SIZE + y) * SIZE + digit
+  };
+
+private: /** ============================= MEMBER VARS ============================= **/
+  grid<char, SIZE> grid_{};
+  std::pmr::vector<Node> nodes_;
+  std::array<size_t, NUM_COLUMNS + 1> column_sizes_{};
+  std::pmr::vector<index_t> selected_rows_;
+  // what the running solve may still spend
+  BudgetMeter meter_{};
+  bool consistent_{true};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  static std::array<size_t, 4> placement_columns(size_t x, size_t y, size_t digit)
+  {
+    size_t box = Shape::BOX_OF[x * SIZE + y];
+    return {1 + x * SIZE + y,
+      1 + NUM_CELLS + x * SIZE + digit,
+      1 + 2 * NUM_CELLS + y * SIZE + digit,
+      1 + 3 * NUM_CELLS + box * SIZE + digit};
+  }
+
+  void build_matrix()
+  {
+    nodes_.reserve(NUM_NODES);
+    nodes_.resize(1 + NUM_COLUMNS);
+
+    for(size_t i = 0; i <= NUM_COLUMNS; ++i)
+    {
+      auto idx = static_cast<index_t>(i);
+      nodes_[i] = {static_cast<index_t>(i == 0 ? NUM_COLUMNS : i - 1),
+        static_cast<index_t>(i == NUM_COLUMNS ? 0 : i + 1),
+        idx,
+        idx,
+        idx,
+        0};
+    }
+
+    for(size_t x = 0; x < SIZE; ++x)
+    {
+      for(size_t y = 0; y < SIZE; ++y)
+      {
+        for(size_t digit = 0; digit < SIZE; ++digit)
+        {
+          auto row = static_cast<index_t>((x * SIZE + y) * SIZE + digit);
+          auto first = static_cast<index_t>(nodes_.size());
+          auto columns = placement_columns(x, y, digit);
+
+          for(size_t k = 0; k < columns.size(); ++k)
+          {
+            auto idx = static_cast<index_t>(nodes_.size());
+            auto column = static_cast<index_t>(columns[k]);
+            auto last = nodes_[column].up;
+            nodes_.push_back({static_cast<index_t>(k == 0 ? first + 3 : idx - 1),
+              static_cast<index_t>(k == 3 ? first : idx + 1),
+              last,
+              column,
+              column,
+              row});
+            nodes_[last].down = idx;
+            nodes_[column].up = idx;
+            ++column_sizes_[column];
+          }
+        }
+      }
+    }
+  }
+
+  void cover(index_t column)
+  {
+    auto& header = nodes_[column];
+    nodes_[header.right].left = header.left;
+    nodes_[header.left].right = header.right;
+
+    for(auto i = header.down; i != column; i = nodes_[i].down)
+    {
+      for(auto j = nodes_[i].right; j != i; j = nodes_[j].right)
+      {
+        auto& node = nodes_[j];
+        nodes_[node.down].up = node.up;
+        nodes_[node.up].down = node.down;
+        --column_sizes_[node.column];
+      }
+    }
+  }
+
+  void uncover(index_t column)
+  {
+    auto& header = nodes_[column];
+    for(auto i = header.up; i != column; i = nodes_[i].up)
+    {
+      for(auto j = nodes_[i].left; j != i; j = nodes_[j].left)
+      {
+        auto& node = nodes_[j];
+        ++column_sizes_[node.column];
+        nodes_[node.down].up = j;
+        nodes_[node.up].down = j;
+      }
+    }
+
+    nodes_[header.right].left = column;
+    nodes_[header.left].right = column;
+  }
+
+  /**
+   * Take the placement of the given node into the solution by covering every
+   * column it satisfies.
+   */
+  void select(index_t node)
+  {
+    selected_rows_.push_back(nodes_[node].row);
+    cover(nodes_[node].column);
+    for(auto j = nodes_[node].right; j != node; j = nodes_[j].right)
+    {
+      cover(nodes_[j].column);
+    }
+  }
+
+  void deselect(index_t node)
+  {
+    for(auto j = nodes_[node].left; j != node; j = nodes_[j].left)
+    {
+      uncover(nodes_[j].column);
+    }
+    uncover(nodes_[node].column);
+    selected_rows_.pop_back();
+  }
+
+  /**
+   * Put the clue into the solution. Returns false if a clue already covers
+   * one of its columns, i.e. the clues contradict each other.
+   */
+  bool select_clue(size_t x, size_t y, size_t digit)
+  {
+    auto columns = placement_columns(x, y, digit);
+    for(auto column : columns)
+    {
+      bool covered = nodes_[nodes_[column].left].right != column;
+      if(covered)
+      {
+        return false;
+      }
+    }
+
+    // the first node of every placement sits in its cell column
+    auto row = (x * SIZE + y) * SIZE + digit;
+    select(static_cast<index_t>(1 + NUM_COLUMNS + 4 * row));
+    return true;
+  }
+
+  void record_solution()
+  {
+    for(auto row : selected_rows_)
+    {
+      size_t cell = row / SIZE;
+      grid_[cell] = DIGITS[row % SIZE];
+    }
+  }
+
+  /**
+   * Count exact covers, stopping once limit of them are found. The first
+   * one found is written into the grid.
+   */
+  size_t search(size_t limit, size_t found)
+  {
+    if(nodes_[ROOT].right == ROOT)
+    {
+      if(found == 0)
+      {
+        record_solution();
+      }
+      return found + 1;
+    }
+
+    // branch on the column with the fewest remaining rows
+    auto column = nodes_[ROOT].right;
+    for(auto c = nodes_[column].right; c != ROOT; c = nodes_[c].right)
+    {
+      if(column_sizes_[c] < column_sizes_[column])
+      {
+        column = c;
+      }
+    }
+
+    for(auto i = nodes_[column].down; i != column and found < limit; i = nodes_[i].down)
+    {
+      if(not meter_.spend())
+      {
+        break;
+      }
+
+      select(i);
+      found = search(limit, found);
+      deselect(i);
+    }
+
+    return found;
+  }
+
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  BasicDlxSolver(std::string_view puzzle, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+    : BasicDlxSolver{BasicBoard<Order>{puzzle}, memory}
+  {}
+
+  /**
+   * Load the checked cells of the board without parsing them again.
+   */
+  explicit BasicDlxSolver(const BasicBoard<Order>& board, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+    : grid_{board.cells()}, nodes_{memory}, selected_rows_{memory}
+  {
+    build_matrix();
+    selected_rows_.reserve(NUM_CELLS);
+
+    for(size_t x = 0; x < SIZE and consistent_; ++x)
+    {
+      for(size_t y = 0; y < SIZE and consistent_; ++y)
+      {
+        char value = get_cell(x, y, grid_);
+        if(value != EMPTY_CELL)
+        {
+          consistent_ = select_clue(x, y, digit_to_idx(value));
+        }
+      }
+    }
+  }
+
+  bool solve()
+  {
+    return count_solutions(1) == 1;
+  }
+
+  /**
+   * Solve the puzzle unless that takes more than the budget, counting every
+   * row selected as a node. Returns SOLVED, VIOLATION if the puzzle has no
+   * solution, or TIMED_OUT once the budget ran out.
+   */
+  GameState solve(const Budget& budget)
+  {
+    if(not consistent_)
+    {
+      return GameState::VIOLATION;
+    }
+
+    meter_ = BudgetMeter{budget};
+    if(search(1, 0))
+    {
+      return GameState::SOLVED;
+    }
+
+    return meter_.exhausted() ? GameState::TIMED_OUT : GameState::VIOLATION;
+  }
+
+  /**
+   * Number of solutions of the puzzle, counting no further than limit.
+   */
+  size_t count_solutions(size_t limit)
+  {
+    if(not consistent_ or limit == 0)
+    {
+      return 0;
+    }
+
+    meter_ = BudgetMeter{};
+    return search(limit, 0);
+  }
+
+  /**
+   * True if the puzzle has exactly one solution. The search stops at the
+   * second one.
+   */
+  bool is_unique()
+  {
+    return count_solutions(2) == 1;
+  }
+
+  /**
+   * The grid as a string of NUM_CELLS digits, filled in once solve() succeeds.
+   */
+  std::string_view solution() const
+  {
+    return {grid_.data(), grid_.size()};
+  }
+
+  void print_solution()
+  {
+    fmt::print("{}\n", solution());
+  }
+};
+
+
+using DlxSolver = BasicDlxSolver<3>;
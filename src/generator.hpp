@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "batch.hpp"
+#include "sudoku_solver.hpp"
+
+
+/**
+ * How many clues a generated puzzle keeps. Clues are removed in random order
+ * for as long as the puzzle keeps a unique solution, down to the level's
+ * share of the cells.
+ */
+enum class Difficulty
+{
+  EASY = 1,   // stops at 4/9 of the cells, 36 clues on a 9x9 grid
+  MEDIUM = 2, // stops at 3/8 of the cells, 30 clues on a 9x9 grid
+  HARD = 3,   // minimal: every clue left is needed for uniqueness
+};
+
+
+inline std::optional<Difficulty> parse_difficulty(std::string_view name)
+{
+  if(name == "easy")
+  {
+    return Difficulty::EASY;
+  }
+  else if(name == "medium")
+  {
+    return Difficulty::MEDIUM;
+  }
+  else if(name == "hard")
+  {
+    return Difficulty::HARD;
+  }
+
+  return std::nullopt;
+}
+
+
+/**
+ * Generates puzzles with a unique solution from random filled grids. The same
+ * seed always gives the same puzzles.
+ */
+template <std::size_t Order>
+class BasicGenerator
+{
+private: /** ============================= TYPES ============================= **/
+  using Shape = Geometry<Order>;
+  using Solver = BasicSudokuSolver<Order>;
+
+  static constexpr std::size_t ORDER = Shape::ORDER;
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::mt19937_64 rng_;
+  // reloaded for every grid tried
+  Solver solver_{BasicBoard<Order>{}};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  static std::string_view view(const grid<char, SIZE>& cells)
+  {
+    return {cells.data(), cells.size()};
+  }
+
+  static std::size_t clue_floor(Difficulty difficulty)
+  {
+    switch(difficulty)
+    {
+      case Difficulty::EASY:
+        return NUM_CELLS * 4 / 9;
+      case Difficulty::MEDIUM:
+        return NUM_CELLS * 3 / 8;
+      case Difficulty::HARD:
+        break;
+    }
+
+    return 0;
+  }
+
+  /**
+   * A random complete grid. The boxes on the diagonal share no unit, so any
+   * digits go there; the solver fills in the rest.
+   */
+  grid<char, SIZE> filled_grid()
+  {
+    for(;;)
+    {
+      grid<char, SIZE> cells{};
+      cells.fill(EMPTY_CELL);
+
+      std::array<char, SIZE> digits{};
+      std::copy_n(DIGITS.begin(), SIZE, digits.begin());
+      for(std::size_t box = 0; box < SIZE; box += ORDER + 1)
+      {
+        std::shuffle(digits.begin(), digits.end(), rng_);
+        auto origin = Shape::box_origin(box);
+        for(std::size_t i = 0; i < SIZE; ++i)
+        {
+          cells[(origin.x + i / ORDER) * SIZE + origin.y + i % ORDER] = digits[i];
+        }
+      }
+
+      solver_.load(view(cells));
+      if(solver_.solve())
+      {
+        std::copy_n(solver_.solution().begin(), NUM_CELLS, cells.begin());
+        return cells;
+      }
+    }
+  }
+
+  /**
+   * Clear the cell if the puzzle stays unique without its clue. Returns true
+   * if it did.
+   */
+  bool remove_clue(grid<char, SIZE>& cells, std::size_t cell)
+  {
+    auto clue = cells[cell];
+    cells[cell] = EMPTY_CELL;
+    solver_.load(view(cells));
+    if(solver_.is_unique())
+    {
+      return true;
+    }
+
+    cells[cell] = clue;
+    return false;
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit BasicGenerator(std::uint64_t seed)
+    : rng_{seed}
+  {}
+
+  /**
+   * A puzzle with a unique solution, as a line of NUM_CELLS cells.
+   */
+  std::string generate(Difficulty difficulty)
+  {
+    auto cells = filled_grid();
+
+    std::array<std::size_t, NUM_CELLS> order{};
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::shuffle(order.begin(), order.end(), rng_);
+
+    auto clues = NUM_CELLS;
+    auto floor = clue_floor(difficulty);
+    for(auto cell : order)
+    {
+      if(clues <= floor)
+      {
+        break;
+      }
+      clues -= remove_clue(cells, cell);
+    }
+
+    return std::string{view(cells)};
+  }
+};
+
+
+using Generator = BasicGenerator<3>;
+
+
+/**
+ * Generate puzzles number first to first + count - 1 on num_threads workers,
+ * one line each, into chunks of BATCH_CHUNK_SIZE lines like solve_batch().
+ * Puzzle number i comes from the seed seed + i, so the output does not depend
+ * on the number of threads.
+ */
+template <std::size_t Order>
+void generate_batch(std::uint64_t first,
+  std::size_t count,
+  Difficulty difficulty,
+  std::uint64_t seed,
+  std::size_t num_threads,
+  std::vector<std::string>& chunks)
+{
+  auto num_chunks = (count + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+  run_chunks(num_chunks, num_threads, chunks, [&](std::size_t i, std::string& out) {
+    auto last = std::min((i + 1) * BATCH_CHUNK_SIZE, count);
+    for(auto k = i * BATCH_CHUNK_SIZE; k < last; ++k)
+    {
+      BasicGenerator<Order> generator{seed + first + k};
+      out.append(generator.generate(difficulty));
+      out.push_back('\n');
+    }
+  });
+}
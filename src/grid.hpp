@@ -0,0 +1,404 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include <fmt/format.h>
+
+
+static constexpr char EMPTY_CELL = '0';
+static constexpr char EMPTY_CELL_DOT = '.';
+
+struct Cell
+{
+  size_t x;
+  size_t y;
+};
+
+
+// Digits in the order of their value. Grids up to 9x9 use '1'-'9', bigger
+// ones carry on with letters: 16x16 ends at 'G' and 25x25 at 'P'.
+static constexpr std::string_view DIGITS = "123456789ABCDEFGHIJKLMNOP";
+
+
+template<typename T>
+struct type_is { using type = T; };
+
+
+template <typename T, std::size_t Size, std::size_t Depth>
+struct NestedArray
+{
+  static_assert(Depth <= 10ul);
+  using type = typename NestedArray<std::array<T, Size>, Size, Depth-1>::type;
+};
+
+
+template <typename T, std::size_t Size>
+struct NestedArray<T, Size, 0> : type_is<T>
+{};
+
+
+template <typename T, std::size_t Size, std::size_t Depth>
+using NestedArray_t = typename NestedArray<T, Size, Depth>::type;
+
+
+template <typename T, std::size_t Size>
+using grid = std::array<T, Size * Size>;
+
+
+/**
+ * Smallest unsigned type with at least the given number of bits.
+ */
+template <std::size_t Bits>
+using uint_least_t = std::conditional_t<Bits <= 8, std::uint8_t,
+  std::conditional_t<Bits <= 16, std::uint16_t,
+  std::conditional_t<Bits <= 32, std::uint32_t, std::uint64_t>>>;
+
+
+/**
+ * Everything that follows from the box order of a grid: order 2 is a 4x4
+ * grid, 3 the classic 9x9 one, 4 is 16x16 and 5 is 25x25.
+ */
+template <std::size_t Order>
+struct Geometry
+{
+  static_assert(Order >= 2 and Order <= 5, "Only grids from 4x4 up to 25x25 are supported");
+
+  static constexpr std::size_t ORDER = Order;
+  static constexpr std::size_t SIZE = Order * Order;
+  static constexpr std::size_t NUM_CELLS = SIZE * SIZE;
+  static constexpr std::size_t NUM_UNITS = 3 * SIZE;
+  // the rest of the row and the column, plus the box cells outside of both
+  static constexpr std::size_t NUM_PEERS = 2 * (SIZE - 1) + (Order - 1) * (Order - 1);
+
+  // one bit per digit: bit 0 stands for '1', bit SIZE - 1 for the last digit
+  using Mask = uint_least_t<SIZE>;
+  // big enough to number every cell
+  using CellIndex = uint_least_t<std::bit_width(NUM_CELLS - 1)>;
+
+  static constexpr Mask ALL_DIGITS = static_cast<Mask>((std::uint64_t{1} << SIZE) - 1);
+
+  static constexpr std::size_t box_of(std::size_t x, std::size_t y)
+  {
+    return (x / Order) * Order + y / Order;
+  }
+
+  /**
+   * Top left cell of the box.
+   */
+  static constexpr Cell box_origin(std::size_t box)
+  {
+    return {(box / Order) * Order, (box % Order) * Order};
+  }
+
+  using CellTable = std::array<std::uint8_t, NUM_CELLS>;
+  using UnitTable = std::array<std::array<CellIndex, SIZE>, NUM_UNITS>;
+  using PeerTable = std::array<std::array<CellIndex, NUM_PEERS>, NUM_CELLS>;
+
+  static constexpr CellTable make_cell_table(std::size_t (*unit_of)(std::size_t, std::size_t))
+  {
+    CellTable table{};
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      table[cell] = static_cast<std::uint8_t>(unit_of(cell / SIZE, cell % SIZE));
+    }
+
+    return table;
+  }
+
+  /**
+   * The cells of every unit: the rows come first, then the columns, then the
+   * boxes.
+   */
+  static constexpr UnitTable make_unit_table()
+  {
+    UnitTable table{};
+    for(std::size_t i = 0; i < SIZE; ++i)
+    {
+      for(std::size_t j = 0; j < SIZE; ++j)
+      {
+        auto origin = box_origin(i);
+        table[i][j] = static_cast<CellIndex>(i * SIZE + j);
+        table[SIZE + i][j] = static_cast<CellIndex>(j * SIZE + i);
+        table[2 * SIZE + i][j] = static_cast<CellIndex>((origin.x + j / Order) * SIZE + origin.y + j % Order);
+      }
+    }
+
+    return table;
+  }
+
+  /**
+   * The cells that share a row, a column or a box with each cell, in
+   * increasing order.
+   */
+  static constexpr PeerTable make_peer_table()
+  {
+    PeerTable table{};
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto x = cell / SIZE, y = cell % SIZE;
+      std::size_t count = 0;
+      for(std::size_t other = 0; other < NUM_CELLS; ++other)
+      {
+        auto i = other / SIZE, j = other % SIZE;
+        bool is_peer = i == x or j == y or box_of(i, j) == box_of(x, y);
+        if(other != cell and is_peer)
+        {
+          table[cell][count++] = static_cast<CellIndex>(other);
+        }
+      }
+    }
+
+    return table;
+  }
+
+  static constexpr CellTable ROW_OF = make_cell_table([](std::size_t x, std::size_t) { return x; });
+  static constexpr CellTable COL_OF = make_cell_table([](std::size_t, std::size_t y) { return y; });
+  static constexpr CellTable BOX_OF = make_cell_table(box_of);
+  static constexpr UnitTable UNITS = make_unit_table();
+  static constexpr PeerTable PEERS = make_peer_table();
+};
+
+
+/**
+ * Box order of a puzzle given as a line of that many cells, or 0 if no
+ * supported grid has that many.
+ */
+constexpr std::size_t order_for_cells(std::size_t num_cells)
+{
+  for(std::size_t order = 2; order <= 5; ++order)
+  {
+    if(order * order * order * order == num_cells)
+    {
+      return order;
+    }
+  }
+
+  return 0;
+}
+
+
+/**
+ * Call fn.template operator()<Order>() for the box order given at runtime.
+ * Orders no grid supports are taken as 3.
+ */
+template <typename Fn>
+decltype(auto) with_order(std::size_t order, Fn&& fn)
+{
+  switch(order)
+  {
+    case 2:
+      return fn.template operator()<2>();
+    case 4:
+      return fn.template operator()<4>();
+    case 5:
+      return fn.template operator()<5>();
+    default:
+      return fn.template operator()<3>();
+  }
+}
+
+
+/**
+ * Length of the side of a square grid with the given number of cells.
+ */
+constexpr std::size_t grid_side(std::size_t num_cells)
+{
+  std::size_t side = 0;
+  while((side + 1) * (side + 1) <= num_cells)
+  {
+    ++side;
+  }
+
+  return side;
+}
+
+
+/**
+ * Throws unless x and y address a cell of the grid. Only the public entry
+ * points check; the accessors below trust their callers and assert in debug
+ * builds.
+ */
+template <typename T, std::size_t Cells>
+inline void check_cell(std::size_t x, std::size_t y, const std::array<T, Cells>&)
+{
+  constexpr auto side = grid_side(Cells);
+  if(x >= side or y >= side)
+  {
+    auto msg = fmt::format("Coordinates x and y must not exceed {} in size", side);
+    throw std::invalid_argument(msg);
+  }
+}
+
+
+template <typename T, std::size_t Cells>
+constexpr T& get_cell(std::size_t x, std::size_t y, std::array<T, Cells>& grid)
+{
+  constexpr auto side = grid_side(Cells);
+  static_assert(side * side == Cells);
+  assert(x < side and y < side);
+
+  return grid[x * side + y];
+}
+
+
+template <typename T, std::size_t Cells>
+constexpr const T& get_cell(std::size_t x, std::size_t y, const std::array<T, Cells>& grid)
+{
+  constexpr auto side = grid_side(Cells);
+  static_assert(side * side == Cells);
+  assert(x < side and y < side);
+
+  return grid[x * side + y];
+}
+
+
+template <typename T, std::size_t Cells>
+constexpr void set_cell(std::size_t x, std::size_t y, std::array<T, Cells>& grid, T value)
+{
+  get_cell(x, y, grid) = value;
+}
+
+
+/**
+ * Puzzles may mark empty cells with either EMPTY_CELL or EMPTY_CELL_DOT.
+ */
+inline char normalize_cell(char value)
+{
+  return value == EMPTY_CELL_DOT ? EMPTY_CELL : value;
+}
+
+
+static constexpr std::size_t NOT_A_DIGIT = std::numeric_limits<std::size_t>::max();
+
+
+/**
+ * Converts the character digit value to the appropriate index: '1'-'9' give
+ * 0-8 and 'A'-'P' carry on from 9. Anything else gives NOT_A_DIGIT.
+ */
+constexpr size_t digit_to_idx(char value)
+{
+  if(value >= '1' and value <= '9')
+  {
+    return static_cast<size_t>(value - '1');
+  }
+  else if(value >= 'A' and value <= 'Z')
+  {
+    return static_cast<size_t>(value - 'A') + 9;
+  }
+
+  return NOT_A_DIGIT;
+}
+
+
+/**
+ * The cell value for a character of a puzzle. Throws on characters that are
+ * neither a digit of the grid nor an empty cell.
+ */
+template <std::size_t Order>
+inline char parse_cell(char value)
+{
+  value = normalize_cell(value);
+  if(value != EMPTY_CELL and digit_to_idx(value) >= Geometry<Order>::SIZE)
+  {
+    auto msg = fmt::format("Invalid character '{}' in the puzzle", value);
+    throw std::invalid_argument(msg);
+  }
+
+  return value;
+}
+
+
+template <typename Mask>
+constexpr Mask digit_to_mask(char value)
+{
+  return static_cast<Mask>(Mask{1} << digit_to_idx(value));
+}
+
+
+/**
+ * The digit of the lowest bit set in the mask.
+ */
+template <typename Mask>
+constexpr char mask_to_digit(Mask mask)
+{
+  return DIGITS[static_cast<std::size_t>(std::countr_zero(mask))];
+}
+
+
+/**
+ * The digits set in a candidate mask, lowest first. Iterating clears one bit
+ * per step, so walking the candidates of a cell costs no allocation and no
+ * more steps than there are candidates.
+ */
+template <typename Mask>
+class DigitRange
+{
+public: /** ============================= TYPES ============================= **/
+  class iterator
+  {
+  private:
+    Mask mask_{};
+
+  public:
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+
+    constexpr iterator() = default;
+    constexpr explicit iterator(Mask mask)
+      : mask_{mask}
+    {}
+
+    constexpr char operator*() const
+    {
+      return mask_to_digit(mask_);
+    }
+
+    constexpr iterator& operator++()
+    {
+      mask_ &= static_cast<Mask>(mask_ - 1);
+      return *this;
+    }
+
+    constexpr iterator operator++(int)
+    {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    constexpr bool operator==(const iterator&) const = default;
+  };
+
+private: /** ============================= MEMBER VARS ============================= **/
+  Mask mask_{};
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  constexpr explicit DigitRange(Mask mask)
+    : mask_{mask}
+  {}
+
+  constexpr iterator begin() const
+  {
+    return iterator{mask_};
+  }
+
+  constexpr iterator end() const
+  {
+    return iterator{};
+  }
+};
+
+
+template <typename Mask>
+constexpr DigitRange<Mask> available_digits(Mask candidates)
+{
+  return DigitRange<Mask>{candidates};
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "board.hpp"
+#include "grid.hpp"
+#include "unit_scan.hpp"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SUDOKU_HAS_LANES 1
+
+/**
+ * Singles propagation for LANES 9x9 puzzles in lockstep. The state is kept
+ * structure-of-arrays: lane number lane of the vector for a cell belongs to
+ * puzzle number lane, so every step of the propagation is a vector operation
+ * on all puzzles. The kernel is written with the GCC/Clang vector extensions
+ * and compiled once per instruction set, picked at runtime like the grid
+ * scans. Propagation stops at the same
+ * fixpoint BasicSudokuSolver reaches with Propagation::SINGLES; puzzles that
+ * are not solved by then are left for the scalar search.
+ */
+class LanePropagator
+{
+public: /** ============================= TYPES ============================= **/
+  // sixteen 16 bit masks fill one AVX2 register
+  static constexpr std::size_t LANES = 16;
+
+private: /** ============================= TYPES ============================= **/
+  using Shape = Geometry<3>;
+  using Mask = Shape::Mask;
+  // one mask per puzzle; the operators work on all lanes at once
+  typedef Mask Lanes __attribute__((vector_size(LANES * sizeof(Mask))));
+
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+  static constexpr Mask ALL_DIGITS = Shape::ALL_DIGITS;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  // vector types lose their attributes as template arguments, hence plain arrays
+  Lanes candidates_[NUM_CELLS]{};
+  // digit placed in each cell as a single bit, 0 while the cell is empty
+  Lanes values_[NUM_CELLS]{};
+  // ALL_DIGITS for puzzles that ran into a contradiction
+  Lanes failed_{};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  [[gnu::always_inline]] static inline bool any(const Lanes& lanes)
+  {
+    std::uint64_t words[sizeof(Lanes) / sizeof(std::uint64_t)];
+    std::memcpy(words, &lanes, sizeof(Lanes));
+
+    std::uint64_t bits = 0;
+    for(auto word : words)
+    {
+      bits |= word;
+    }
+    return bits != 0;
+  }
+
+  /**
+   * Place every naked single and strike it from the peers, then narrow every
+   * hidden single down to its digit. Returns false once no lane changes.
+   */
+  [[gnu::always_inline]] inline bool sweep()
+  {
+    const Lanes none{};
+    const Lanes all = none + ALL_DIGITS;
+    Lanes progress{};
+
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto candidates = candidates_[cell];
+      auto single = (candidates != 0) & ((candidates & (candidates - 1)) == 0);
+      auto stuck = (candidates == 0) & (values_[cell] == 0);
+
+      Lanes digits = single ? candidates : none;
+      failed_ = stuck ? all : failed_;
+      values_[cell] |= digits;
+      candidates_[cell] = candidates & ~digits;
+
+      Lanes placed = digits & ~failed_;
+      if(not any(placed))
+      {
+        continue;
+      }
+
+      progress |= placed;
+      for(auto peer : Shape::PEERS[cell])
+      {
+        candidates_[peer] &= ~digits;
+      }
+    }
+
+    for(const auto& unit : Shape::UNITS)
+    {
+      Lanes once{}, twice{}, used{};
+      for(auto cell : unit)
+      {
+        twice |= once & candidates_[cell];
+        once |= candidates_[cell];
+        used |= values_[cell];
+      }
+
+      // a digit that fits nowhere in the unit
+      failed_ = (once | used) != all ? all : failed_;
+      once &= ~twice;
+
+      for(auto cell : unit)
+      {
+        auto candidates = candidates_[cell];
+        Lanes hidden = candidates & once;
+        // two hidden singles in one cell can't both be placed
+        failed_ = (hidden & (hidden - 1)) != 0 ? all : failed_;
+        progress |= hidden != candidates ? hidden & ~failed_ : none;
+        candidates_[cell] = hidden != 0 ? hidden : candidates;
+      }
+    }
+
+    return any(progress);
+  }
+
+  [[gnu::always_inline]] inline void propagate_lanes()
+  {
+    while(sweep())
+    {}
+  }
+
+#ifdef SUDOKU_HAS_X86_SIMD
+  [[gnu::target("avx2")]] void propagate_avx2()
+  {
+    propagate_lanes();
+  }
+
+  [[gnu::target("sse4.1")]] void propagate_sse41()
+  {
+    propagate_lanes();
+  }
+#endif
+
+  void propagate_scalar()
+  {
+    propagate_lanes();
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * Every lane starts out empty and failed until a puzzle is loaded into it.
+   */
+  LanePropagator()
+  {
+    failed_ += ALL_DIGITS;
+  }
+
+  /**
+   * Put the puzzle into the lane. The puzzle must have exactly NUM_CELLS
+   * cells; invalid characters throw like they do for BasicSudokuSolver.
+   */
+  void load(std::size_t lane, std::string_view puzzle)
+  {
+    grid<char, SIZE> cells{};
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      cells[cell] = parse_cell<3>(puzzle[cell]);
+    }
+
+    load(lane, Board{cells});
+  }
+
+  /**
+   * Put the checked cells of the board into the lane.
+   */
+  void load(std::size_t lane, const Board& board)
+  {
+    const auto& cells = board.cells();
+    grid<Mask, SIZE> candidates{};
+    auto scan = scan_grid<3>(cells, candidates);
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      candidates_[cell][lane] = candidates[cell];
+      values_[cell][lane] = cells[cell] == EMPTY_CELL ? Mask{0} : digit_to_mask<Mask>(cells[cell]);
+    }
+    failed_[lane] = scan.duplicate ? ALL_DIGITS : Mask{0};
+  }
+
+  /**
+   * Run singles propagation on all lanes until none of them changes any more.
+   */
+  void propagate()
+  {
+#ifdef SUDOKU_HAS_X86_SIMD
+    switch(simd_level())
+    {
+      case SimdLevel::AVX2:
+        return propagate_avx2();
+      case SimdLevel::SSE41:
+        return propagate_sse41();
+      case SimdLevel::SCALAR:
+        break;
+    }
+#endif
+    propagate_scalar();
+  }
+
+  /**
+   * True if the puzzle in the lane has no solution.
+   */
+  bool failed(std::size_t lane) const
+  {
+    return failed_[lane] != 0;
+  }
+
+  bool solved(std::size_t lane) const
+  {
+    for(const auto& cell_values : values_)
+    {
+      if(not cell_values[lane])
+      {
+        return false;
+      }
+    }
+
+    return not failed(lane);
+  }
+
+  /**
+   * The grid of the lane as a line of digits, EMPTY_CELL where propagation
+   * left a cell open.
+   */
+  grid<char, SIZE> cells(std::size_t lane) const
+  {
+    grid<char, SIZE> line{};
+    for(std::size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto value = values_[cell][lane];
+      line[cell] = value ? mask_to_digit(value) : EMPTY_CELL;
+    }
+
+    return line;
+  }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+
+/**
+ * Least recently used cache that any number of threads can share. The keys
+ * are spread over shards by hash, each with its own lock, list and index, so
+ * threads only contend when they hit the same shard. Every shard evicts on
+ * its own once it holds its share of the capacity.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLruCache
+{
+private: /** ============================= TYPES ============================= **/
+  using Entries = std::list<std::pair<Key, Value>>;
+
+  // keeps the locks of neighbouring shards on separate cache lines
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  struct alignas(CACHE_LINE) Shard
+  {
+    std::mutex mutex{};
+    // most recently used first
+    Entries entries{};
+    std::unordered_map<Key, typename Entries::iterator, Hash> index{};
+  };
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::size_t num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+  std::size_t shard_capacity_;
+  Hash hash_{};
+  std::atomic<std::size_t> hits_{0};
+  std::atomic<std::size_t> misses_{0};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  Shard& shard_for(const Key& key)
+  {
+    // the index buckets by the low bits of the hash, the shards go by the high ones
+    std::uint64_t mixed = hash_(key) * 0x9E3779B97F4A7C15;
+    return shards_[(mixed >> 32) & (num_shards_ - 1)];
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * Room for about capacity entries in num_shards shards, rounded up to a
+   * power of two. A cache without capacity keeps nothing.
+   */
+  explicit ShardedLruCache(std::size_t capacity, std::size_t num_shards = 64)
+    : num_shards_{std::bit_ceil(std::max<std::size_t>(num_shards, 1))},
+      shards_{std::make_unique<Shard[]>(num_shards_)},
+      shard_capacity_{(capacity + num_shards_ - 1) / num_shards_}
+  {}
+
+  ShardedLruCache(const ShardedLruCache&) = delete;
+  ShardedLruCache& operator=(const ShardedLruCache&) = delete;
+
+  /**
+   * A copy of the value cached for the key, which counts as a use of it.
+   */
+  std::optional<Value> get(const Key& key)
+  {
+    auto& shard = shard_for(key);
+    std::lock_guard lock{shard.mutex};
+    auto it = shard.index.find(key);
+    if(it == shard.index.end())
+    {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return it->second->second;
+  }
+
+  /**
+   * Cache the value for the key, replacing what was there, and drop the least
+   * recently used entry of the shard if it is full.
+   */
+  void put(Key key, Value value)
+  {
+    if(not shard_capacity_)
+    {
+      return;
+    }
+
+    auto& shard = shard_for(key);
+    std::lock_guard lock{shard.mutex};
+    auto it = shard.index.find(key);
+    if(it != shard.index.end())
+    {
+      it->second->second = std::move(value);
+      shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+      return;
+    }
+
+    if(shard.entries.size() == shard_capacity_)
+    {
+      shard.index.erase(shard.entries.back().first);
+      shard.entries.pop_back();
+    }
+
+    shard.entries.emplace_front(std::move(key), std::move(value));
+    shard.index.emplace(shard.entries.front().first, shard.entries.begin());
+  }
+
+  /**
+   * Entries cached right now. Only exact while no other thread uses the cache.
+   */
+  std::size_t size()
+  {
+    std::size_t size = 0;
+    for(std::size_t i = 0; i < num_shards_; ++i)
+    {
+      std::lock_guard lock{shards_[i].mutex};
+      size += shards_[i].entries.size();
+    }
+
+    return size;
+  }
+
+  std::size_t capacity() const
+  {
+    return shard_capacity_ * num_shards_;
+  }
+
+  std::size_t hits() const
+  {
+    return hits_.load(std::memory_order_relaxed);
+  }
+
+  std::size_t misses() const
+  {
+    return misses_.load(std::memory_order_relaxed);
+  }
+};
@@ -1,515 +1,567 @@
 #include <algorithm>
-#include <array>
-#include <fstream>
-#include <numeric>
-#include <queue>
-#include <stack>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include <docopt/docopt.h>
 #include <fmt/format.h>
+#include <spdlog/sinks/stdout_sinks.h>
 #include <spdlog/spdlog.h>
 
-
-static constexpr char EMPTY_CELL = '0';
-
-struct Cell
-{
-  size_t x;
-  size_t y;
-};
+#include "batch.hpp"
+#include "generator.hpp"
+#include "output_writer.hpp"
+#include "packed_format.hpp"
+#include "puzzle_reader.hpp"
+#include "search_stats.hpp"
+#include "solver.hpp"
+#include "stream_pipeline.hpp"
 
 
+static constexpr char USAGE[] =
+R"(solve
 
-static constexpr std::size_t SIZE = 9;
-static constexpr std::size_t NUM_CELLS = 81;
+    Usage:
+      solve [options] <file>
+      solve generate [options]
+      solve convert [options] <file>
+      solve (-h | --help)
 
-static const std::array<Cell, SIZE> quadrants = {{ {1, 1}, {1, 4}, {1, 7},
-                                                   {4, 1}, {4, 4}, {4, 7},
-                                                   {7, 1}, {7, 4}, {7, 7} }};
+    Reads one puzzle per line from <file>, or from stdin as the lines come in
+    if <file> is -, and writes one answer per line in the same order. Files in
+    the packed binary format are recognized by their header; convert turns
+    puzzle lines into a packed file and a packed file back into lines.
 
+    Options:
+      -h --help           Show this screen.
+      --backend=<name>    Search engine to use: backtrack or dlx [default: backtrack].
+      -t --threads=<n>    Worker threads to solve with, 0 for one per core [default: 1].
+      -o --output=<file>  Write the solutions to the file instead of stdout.
+      --split             Search each puzzle on all threads in turn instead of
+                          solving one puzzle per thread (backtrack only).
+      --count=<limit>     Print how many solutions each puzzle has, counting no
+                          further than limit. 2 checks for unique solutions.
+      --stats             Log what the search did for every puzzle to stderr,
+                          and histograms for all of them (backtrack only).
+      --rate              Print how hard each puzzle is for a human instead of
+                          solving it: a score and the hardest technique it needs,
+                          search if the techniques alone get stuck (backtrack only).
+      --cache=<n>         Remember the solutions of up to n puzzles and answer
+                          their symmetric variants without solving them again.
+      -n --puzzles=<n>    Number of puzzles to generate [default: 1].
+      --seed=<n>          Seed of the first generated puzzle [default: 1].
+      --difficulty=<lvl>  Puzzles to generate: easy, medium or hard [default: hard].
+                          Hard puzzles are minimal.
+)";
 
-template<typename T>
-struct type_is { using type = T; };
+// Puzzles handed to the workers at a time.
+static constexpr std::size_t READ_BATCH_SIZE = 1 << 16;
 
 
-template <typename T, std::size_t Size, std::size_t Depth>
-struct NestedArray
+/**
+ * Solve every puzzle in the buffer, one per line, on num_threads workers and
+ * write the solutions, or the solution counts, in input order. The puzzles
+ * are passed to the solvers as views into the buffer.
+ */
+template <template <std::size_t> class Engine>
+void solve_puzzles(std::string_view data,
+  std::size_t num_threads,
+  std::optional<std::size_t> count,
+  OutputWriter& output,
+  SolutionCache* cache)
 {
-  static_assert(Depth <= 10ul);
-  using type = typename NestedArray<std::array<T, Size>, Size, Depth-1>::type;
-};
-
-
-template <typename T, std::size_t Size>
-struct NestedArray<T, Size, 0> : type_is<T>
-{};
-
-
-template <typename T, std::size_t Size, std::size_t Depth>
-using NestedArray_t = typename NestedArray<T, Size, Depth>::type;
+  RecordReader reader{data};
+  std::vector<std::string_view> puzzles(READ_BATCH_SIZE);
+  std::vector<std::string> chunks{};
 
+  for(bool more = true; more;)
+  {
+    std::size_t size = 0;
+    while(size < puzzles.size() and (more = reader.next(puzzles[size])))
+    {
+      ++size;
+    }
 
-template <typename T, std::size_t Size>
-using grid = std::array<T, Size * Size>;
+    solve_batch<Engine>(std::span<const std::string_view>{puzzles.data(), size}, num_threads, chunks, count, cache);
+    for(auto& chunk : chunks)
+    {
+      output.write(chunk);
+    }
+  }
+}
 
 
-template <template <typename, std::size_t> class Grid, typename T, std::size_t Size>
-inline T& get_cell(std::size_t x, std::size_t y, Grid<T, Size>& grid)
+/**
+ * Rate every puzzle in the buffer, one per line, on num_threads workers and
+ * write the ratings in input order.
+ */
+void rate_puzzles(std::string_view data, std::size_t num_threads, OutputWriter& output)
 {
-  if(x >= Size or y >= Size)
+  RecordReader reader{data};
+  std::vector<std::string_view> puzzles(READ_BATCH_SIZE);
+  std::vector<std::string> chunks{};
+
+  for(bool more = true; more;)
   {
-    auto msg = fmt::format("Coordinates x and y must not exceed {} in size", SIZE);
-    throw std::invalid_argument(msg);
-  }
+    std::size_t size = 0;
+    while(size < puzzles.size() and (more = reader.next(puzzles[size])))
+    {
+      ++size;
+    }
 
-  return grid[x * SIZE + y];
+    rate_batch(std::span<const std::string_view>{puzzles.data(), size}, num_threads, chunks);
+    for(auto& chunk : chunks)
+    {
+      output.write(chunk);
+    }
+  }
 }
 
 
-template <template <typename, std::size_t> class Grid, typename T, std::size_t Size>
-inline void set_cell(std::size_t x, std::size_t y, Grid<T, Size>& grid, T value)
+/**
+ * Log the histogram, one line per bucket from the first to the last one used.
+ */
+void log_histogram(spdlog::logger& log, std::string_view title, const StatsSummary::Histogram& histogram)
 {
-  if(x >= Size or y >= Size)
+  auto used = [](std::size_t n) { return n != 0; };
+  auto first = std::find_if(histogram.begin(), histogram.end(), used);
+  auto last = std::find_if(histogram.rbegin(), histogram.rend(), used).base();
+  auto peak = std::max<std::size_t>(*std::max_element(histogram.begin(), histogram.end()), 1);
+
+  log.info("{}:", title);
+  for(auto it = first; it < last; ++it)
   {
-    auto msg = fmt::format("Coordinates x and y must not exceed {} in size", SIZE);
-    throw std::invalid_argument(msg);
+    auto i = static_cast<std::size_t>(std::distance(histogram.begin(), it));
+    auto bar = std::string((*it * 50 + peak - 1) / peak, '#');
+    log.info("  >= {:<10} {:>9} {}", StatsSummary::bucket_floor(i), *it, bar);
   }
-
-  grid[x * SIZE + y] = value;
 }
 
 
 /**
- * Converts the character digit value to the appropriate index.
- * **STRONG** assumption - value will never be less than '1'.
+ * Like solve_puzzles() with the backtracking engine, logging the search stats
+ * of every puzzle to stderr as it goes and a summary of all of them at the end.
  */
-size_t digit_to_idx(char value)
+void solve_with_stats(std::string_view data,
+  std::size_t num_threads,
+  std::optional<std::size_t> count,
+  OutputWriter& output)
 {
-  return static_cast<size_t>(value - '1');
-}
+  auto log = spdlog::stderr_logger_st("stats");
+  log->set_pattern("%v");
 
+  RecordReader reader{data};
+  std::vector<std::string_view> puzzles(READ_BATCH_SIZE);
+  std::vector<std::string> chunks{};
+  std::vector<SearchStats> stats{};
+  StatsSummary summary{};
 
-std::vector<char> available_digits(auto& constraints)
-{
-  std::vector<char> digits{SIZE};
-  for(auto [digit, i] = std::tuple{'1', 0ul}; i < SIZE; ++i, ++digit)
+  for(bool more = true; more;)
   {
-    if(constraints[i])
+    std::size_t size = 0;
+    while(size < puzzles.size() and (more = reader.next(puzzles[size])))
     {
-      digits.push_back(digit);
+      ++size;
     }
-  }
-
-  if(digits.size()) return digits;
-  digits.push_back(EMPTY_CELL);
-
-  return digits;
-}
-
 
-using ConstraintsCube = NestedArray_t<bool, SIZE, 3>;
+    solve_batch_stats(std::span<const std::string_view>{puzzles.data(), size}, num_threads, chunks, count, stats);
+    for(auto& chunk : chunks)
+    {
+      output.write(chunk);
+    }
 
+    for(const auto& puzzle : stats)
+    {
+      log->info("puzzle {}: nodes={} guesses={} backtracks={} propagations={} max_depth={} time={}us",
+        summary.puzzles() + 1,
+        puzzle.nodes,
+        puzzle.guesses,
+        puzzle.backtracks,
+        puzzle.propagations,
+        puzzle.max_depth,
+        std::chrono::duration_cast<std::chrono::microseconds>(puzzle.time_spent).count());
+      summary.add(puzzle);
+    }
+  }
 
-enum class GameState
-{
-  SOLVED = 1,
-  VIOLATION = 2,
-  VALID = 3,
-  NO_CHOICES_FOR_EMPTY_CELL = 4,
-};
+  const auto& total = summary.total();
+  log->info("{} puzzles: nodes={} guesses={} backtracks={} propagations={} max_depth={} time={}us",
+    summary.puzzles(),
+    total.nodes,
+    total.guesses,
+    total.backtracks,
+    total.propagations,
+    total.max_depth,
+    std::chrono::duration_cast<std::chrono::microseconds>(total.time_spent).count());
+  if(summary.puzzles())
+  {
+    log_histogram(*log, "nodes per puzzle", summary.nodes());
+    log_histogram(*log, "microseconds per puzzle", summary.micros());
+  }
+}
 
 
-class SudokuSolver
+/**
+ * Like solve_puzzles() for a file of packed puzzles.
+ */
+template <template <std::size_t> class Engine>
+void solve_packed(const PackedPuzzles& packed,
+  std::size_t num_threads,
+  std::optional<std::size_t> count,
+  OutputWriter& output,
+  SolutionCache* cache)
 {
-private: /** ============================= MEMBER VARS ============================= **/
-  grid<char, SIZE> grid_{};
-  grid<size_t, SIZE> constraint_counts_{};
-  ConstraintsCube constraints_{};
-
-private: /** ============================= MEMBER METHODS ============================= **/
-  void update_constraints()
+  std::vector<std::string> chunks{};
+  for(std::size_t first = 0; first < packed.count; first += READ_BATCH_SIZE)
   {
-    for(size_t x = 0; x < SIZE; ++x)
+    auto size = std::min(packed.count - first, READ_BATCH_SIZE);
+    solve_packed_batch<Engine>(packed, first, size, num_threads, chunks, count, cache);
+    for(auto& chunk : chunks)
     {
-      for(size_t y = 0; y < SIZE; ++y)
-      {
-        update_constraint(x, y);
-      }
+      output.write(chunk);
     }
   }
+}
 
-  void update_constraint(size_t x, size_t y)
-  {
-    char& value = get_value(x, y);
-    auto& cell_constraints = constraints_[x][y];
 
-    bool filled_cell = value != EMPTY_CELL;
-    if(filled_cell)
-    {
-      cell_constraints.fill(false);
-      return;
-    }
+/**
+ * The packed puzzles as lines of text.
+ */
+std::string unpack_lines(const PackedPuzzles& packed)
+{
+  return with_order(packed.order, [&]<std::size_t Order>() {
+    constexpr auto NUM_CELLS = Geometry<Order>::NUM_CELLS;
 
-    for(size_t step = 0; step < SIZE; ++step)
+    std::string lines(packed.count * (NUM_CELLS + 1), '\n');
+    for(std::size_t k = 0; k < packed.count; ++k)
     {
-      if(step != y)
-      {
-        char row_value = get_value(x, step);
-        filled_cell = row_value != EMPTY_CELL;
-        if(filled_cell)
-        {
-          size_t idx = digit_to_idx(row_value);
-          cell_constraints[idx] = false;
-        }
-      }
-
-      if(step != x)
-      {
-        char col_value = get_value(step, y);
-        filled_cell = col_value != EMPTY_CELL;
-        if(filled_cell)
-        {
-          size_t idx = digit_to_idx(col_value);
-          cell_constraints[idx] = false;
-        }
-      }
+      unpack_puzzle<Order>(packed.record(k), lines.data() + k * (NUM_CELLS + 1));
     }
+    return lines;
+  });
+}
 
-    update_constraint_from_quadrant(x, y, cell_constraints);
-
-    size_t& count = get_constraint_count(x, y);
-    count = std::accumulate(cell_constraints.begin(), cell_constraints.end(), 0ul);
-  }
 
-  size_t find_closest_quadrant_idx(size_t x, size_t y)
+/**
+ * Pack the puzzle lines of data, which must all have the same size, into a
+ * packed file with a header.
+ */
+void pack_lines(std::string_view data, OutputWriter& output)
+{
+  RecordReader reader{data};
+  std::vector<std::string_view> puzzles{};
+  for(std::string_view puzzle; reader.next(puzzle);)
   {
-    size_t min_idx = 0, dist = 1000; // 1000 is as good as MAX_INT in this case
-    for(size_t i = 0ul; i < quadrants.size(); ++i)
-    {
-      auto& q = quadrants[i];
-      auto x_diff = std::max(x, q.x) - std::min(x, q.x);
-      auto y_diff = std::max(y, q.y) - std::min(y, q.y);
-      auto cur_dist = x_diff + y_diff;
-      if(cur_dist < dist)
-      {
-        dist = cur_dist;
-        min_idx = i;
-      }
-    }
-
-    return min_idx;
+    puzzles.push_back(puzzle);
   }
 
-  void update_constraint_from_quadrant(size_t x, size_t y, std::array<bool, SIZE>& constraints)
+  auto order = puzzles.empty() ? 3 : order_for_cells(puzzles.front().size());
+  if(not order)
   {
-    auto min_idx = find_closest_quadrant_idx(x, y);
-    Cell closest = quadrants[min_idx];
+    throw std::invalid_argument(fmt::format("No grid has {} cells", puzzles.front().size()));
+  }
 
-    for(auto i = closest.x - 1; i <= closest.x + 1; ++i)
+  std::string out{};
+  write_packed_header(order, puzzles.size(), out);
+  with_order(order, [&]<std::size_t Order>() {
+    for(auto puzzle : puzzles)
     {
-      for(auto j = closest.y - 1; j <= closest.y + 1; ++j)
+      pack_puzzle<Order>(puzzle, out);
+      if(out.size() >= READ_BATCH_SIZE)
       {
-        auto value = get_value(i, j);
-        if(value != EMPTY_CELL)
-        {
-          size_t idx = digit_to_idx(value);
-          constraints[idx] = false;
-        }
+        output.write(out);
+        out.clear();
       }
     }
-  }
+  });
+  output.write(out);
+}
+
 
-  /**
-   * Limit possible choices based on the row, column and square constraints
-   * then apply back-tracking algorithm.
-   */
-  bool solve(size_t row, size_t start_col)
+/**
+ * The convert subcommand: pack a file of puzzle lines, or unpack a packed file.
+ */
+int convert(std::map<std::string, docopt::value>& args)
+{
+  try
   {
-    if(row >= SIZE)
+    MappedFile input{args["<file>"].asString()};
+    auto output = args["--output"] ? OutputWriter{args["--output"].asString()} : OutputWriter{};
+    if(is_packed(input.view()))
     {
-      return true;
+      output.write(unpack_lines(read_packed(input.view())));
     }
-
-    bool solved = false;
-    for(size_t col = start_col; col < SIZE; ++col)
+    else
     {
-      if(solved) break;
-      auto value = get_value(row, col);
-      bool is_filled = value != EMPTY_CELL;
-
-      // go to the next cell
-      if(is_filled)
-      {
-        continue;
-      }
-
-      auto& constraints = constraints_[row][col];
+      pack_lines(input.view(), output);
+    }
+    output.flush();
+  }
+  catch(const std::exception& e)
+  {
+    fmt::print(stderr, "{}\n", e.what());
+    return 1;
+  }
 
-      for(auto digit : available_digits(constraints))
-      {
-        if(digit == EMPTY_CELL)
-        {
-          set_value(row, col, EMPTY_CELL);
-          break;
-        }
-        set_value(row, col, digit);
+  return 0;
+}
 
-        auto state = get_game_state();
 
-        if(state == GameState::SOLVED)
-        {
-          return true;
-        }
-        else if(state != GameState::VALID)
-        {
-          set_value(row, col, EMPTY_CELL);
-          continue;
-        }
+/**
+ * Solve the puzzles one after another, splitting the search for each of them
+ * across num_threads workers. Meant for a few hard puzzles, where one puzzle
+ * per thread would leave the other cores idle.
+ */
+void solve_split(std::string_view data,
+  std::size_t num_threads,
+  std::optional<std::size_t> count,
+  OutputWriter& output)
+{
+  RecordReader reader{data};
+  std::string line{};
+  for(std::string_view puzzle; reader.next(puzzle);)
+  {
+    line.clear();
+    answer_into<ParallelSearch>(puzzle, count, line, num_threads);
+    output.write(line);
+  }
+}
 
-        solved = solve(row, col+1);
-        if(not solved)
-        {
-          set_value(row, col, EMPTY_CELL);
-        }
-        else
-        {
-          break;
-        }
-      }
 
-      // tried every valid digit and still no solution? dead path
-      if(not solved)
-      {
-        return false;
-      }
+/**
+ * Generate count 9x9 puzzles with unique solutions on num_threads workers and
+ * write them one per line. The same seed gives the same puzzles on any number
+ * of threads.
+ */
+void generate_puzzles(std::size_t count,
+  Difficulty difficulty,
+  std::uint64_t seed,
+  std::size_t num_threads,
+  OutputWriter& output)
+{
+  std::vector<std::string> chunks{};
+  for(std::size_t first = 0; first < count; first += READ_BATCH_SIZE)
+  {
+    auto size = std::min(count - first, READ_BATCH_SIZE);
+    generate_batch<3>(first, size, difficulty, seed, num_threads, chunks);
+    for(auto& chunk : chunks)
+    {
+      output.write(chunk);
     }
-
-    return solve(row + 1, 0);
   }
+}
 
 
-public: /** ============================= MEMBER METHODS ============================= **/
-  bool solve()
+/**
+ * The generate subcommand: parse its options and write the puzzles.
+ */
+int generate(std::map<std::string, docopt::value>& args, std::size_t num_threads)
+{
+  auto difficulty = parse_difficulty(args["--difficulty"].asString());
+  if(not difficulty)
   {
-    return solve(0, 0);
+    fmt::print(stderr, "Unknown difficulty '{}'\n", args["--difficulty"].asString());
+    return 1;
   }
 
-  SudokuSolver(std::string_view puzzle)
+  auto count = args["--puzzles"].asLong();
+  auto seed = args["--seed"].asLong();
+  if(count < 0 or seed < 0)
   {
-    for(auto& row : constraints_)
-    {
-      for(auto& col : row)
-      {
-        // assume all digits are available at first
-        col.fill(true);
-      }
-    }
+    fmt::print(stderr, "Number of puzzles and seed must not be negative\n");
+    return 1;
+  }
 
-    std::size_t x = 0, y = 0;
+  try
+  {
+    auto output = args["--output"] ? OutputWriter{args["--output"].asString()} : OutputWriter{};
+    generate_puzzles(static_cast<std::size_t>(count), *difficulty, static_cast<std::uint64_t>(seed), num_threads, output);
+    output.flush();
+  }
+  catch(const std::exception& e)
+  {
+    fmt::print(stderr, "{}\n", e.what());
+    return 1;
+  }
 
-    size_t num_cells = 0;
-    for(auto c : puzzle)
-    {
-      set_value(x, y++, c);
+  return 0;
+}
 
-      if(y == SIZE)
-      {
-        y = 0;
-        ++x;
-      }
-      ++num_cells;
 
-      if(num_cells > NUM_CELLS)
-      {
-        throw std::range_error("Too many digits in the puzzle");
-      }
-    }
+int main(int argc, const char **argv)
+{
+  std::map<std::string, docopt::value> args = docopt::docopt(USAGE, {std::next(argv), std::next(argv, argc)}, true);
 
-    update_constraints();
+  auto backend = parse_backend(args["--backend"].asString());
+  if(not backend)
+  {
+    fmt::print(stderr, "Unknown backend '{}'\n", args["--backend"].asString());
+    return 1;
   }
 
-  GameState get_game_state()
+  auto threads = args["--threads"].asLong();
+  if(threads < 0)
   {
-    size_t num_filled_cells = 0;
-    for(size_t row_col = 0; row_col < SIZE; ++row_col)
-    {
-      std::array<bool, SIZE> row_set{};
-      std::array<bool, SIZE> col_set{};
-
-      for(size_t step = 0; step < SIZE; ++step)
-      {
-        size_t row = row_col;
-        size_t col = row_col;
+    fmt::print(stderr, "Number of threads must not be negative\n");
+    return 1;
+  }
 
-        char row_value = get_value(row, step);
-        char col_value = get_value(step, col);
+  auto num_threads = threads == 0 ? std::thread::hardware_concurrency() : static_cast<std::size_t>(threads);
 
-        bool filled_cell = row_value != EMPTY_CELL;
-        if(filled_cell)
-        {
-          // count filled cells by rows
-          ++num_filled_cells;
-          size_t row_idx = digit_to_idx(row_value);
-          bool is_duplicate = row_set[row_idx];
-          if(is_duplicate)
-          {
-            return GameState::VIOLATION;
-          }
-          row_set[row_idx] = true;
-        }
-        else
-        {
-          auto constraint_count = get_constraint_count(row, step);
-          if(constraint_count == 0)
-          {
-            return GameState::NO_CHOICES_FOR_EMPTY_CELL;
-          }
-        }
-
-        filled_cell = col_value != EMPTY_CELL;
-        if(filled_cell)
-        {
-          size_t col_idx = digit_to_idx(col_value);
-          bool is_duplicate = col_set[col_idx];
-          if(is_duplicate)
-          {
-            return GameState::VIOLATION;
-          }
-          col_set[col_idx] = true;
-        }
-      }
-    }
+  if(args["generate"].asBool())
+  {
+    return generate(args, num_threads);
+  }
+  else if(args["convert"].asBool())
+  {
+    return convert(args);
+  }
 
-    for(auto& q : quadrants)
+  std::optional<std::size_t> count{};
+  if(args["--count"])
+  {
+    auto limit = args["--count"].asLong();
+    if(limit < 1)
     {
-      std::array<bool, SIZE> quadrant_set{};
-      for(auto i = q.x - 1; i <= q.x + 1; ++i)
-      {
-        for(auto j = q.y - 1; j <= q.y + 1; ++j)
-        {
-          auto value = get_value(i, j);
-          if(value != EMPTY_CELL)
-          {
-            size_t idx = digit_to_idx(value);
-            bool is_duplicate = quadrant_set[idx];
-            if(is_duplicate)
-            {
-              return GameState::VIOLATION;
-            }
-            quadrant_set[idx] = true;
-          }
-        }
-      }
+      fmt::print(stderr, "Count limit must be at least 1\n");
+      return 1;
     }
+    count = static_cast<std::size_t>(limit);
+  }
 
-    if(num_filled_cells == NUM_CELLS) return GameState::SOLVED;
-    return GameState::VALID;
+  bool split = args["--split"].asBool();
+  if(split and *backend != Backend::BACKTRACK)
+  {
+    fmt::print(stderr, "--split needs the backtrack backend\n");
+    return 1;
   }
 
-  inline char& get_value(std::size_t x, std::size_t y)
+  bool stats = args["--stats"].asBool();
+  if(stats and (split or *backend != Backend::BACKTRACK))
   {
-    return get_cell(x, y, grid_);
+    fmt::print(stderr, "--stats needs the backtrack backend without --split\n");
+    return 1;
   }
 
-  inline size_t& get_constraint_count(std::size_t x, std::size_t y)
+  bool rate = args["--rate"].asBool();
+  if(rate and (count or split or stats or *backend != Backend::BACKTRACK))
   {
-    return get_cell(x, y, constraint_counts_);
+    fmt::print(stderr, "--rate needs the backtrack backend without --count, --split or --stats\n");
+    return 1;
   }
 
-  inline void set_value(std::size_t x, std::size_t y, char value)
+  std::optional<SolutionCache> cache{};
+  if(args["--cache"])
   {
-    set_cell(x, y, grid_, value);
+    auto entries = args["--cache"].asLong();
+    if(entries < 1)
+    {
+      fmt::print(stderr, "Cache size must be at least 1\n");
+      return 1;
+    }
+    else if(count or split or stats or rate)
+    {
+      fmt::print(stderr, "--cache can't be combined with --count, --split, --stats or --rate\n");
+      return 1;
+    }
+    cache.emplace(static_cast<std::size_t>(entries));
   }
+  auto* shared_cache = cache ? &*cache : nullptr;
 
-  void print_grid(size_t hx=1000, size_t hy=1000)
+  bool streaming = args["<file>"].asString() == "-";
+  if(streaming and (split or stats or rate))
   {
-    static const std::string GREEN = "\033[32m";
-    static const std::string RESET = "\033[0m";
+    fmt::print(stderr, "--split, --stats and --rate need a file to read from\n");
+    return 1;
+  }
 
-    for(size_t x = 0; x < SIZE; ++x)
+  try
+  {
+    if(streaming)
     {
-      for(size_t y = 0; y < SIZE; ++y)
+      StreamReader reader{};
+      auto output = args["--output"] ? OutputWriter{args["--output"].asString()} : OutputWriter{};
+      switch(*backend)
       {
-        if(x == hx and y == hy)
-        {
-          fmt::print(" {}{}{}", GREEN, get_value(x, y), RESET);
-        }
-        else
-        {
-          fmt::print(" {}", get_value(x, y));
-        }
+        case Backend::BACKTRACK:
+          solve_stream<BasicSudokuSolver>(reader, num_threads, count, output, shared_cache);
+          break;
+        case Backend::DLX:
+          solve_stream<BasicDlxSolver>(reader, num_threads, count, output, shared_cache);
+          break;
       }
-      fmt::print("\n");
+      output.flush();
+      return 0;
     }
-  }
 
+    MappedFile input{args["<file>"].asString()};
+    std::string_view data = input.view();
+    std::optional<PackedPuzzles> packed{};
+    std::string unpacked{};
+    if(is_packed(data))
+    {
+      packed = read_packed(data);
+    }
 
-  void print_solution()
-  {
-    fmt::print("{}\n", fmt::join(grid_, ""));
-  }
+    // only the batch paths read packed puzzles directly
+    if(packed and (split or stats or rate))
+    {
+      unpacked = unpack_lines(*packed);
+      data = unpacked;
+      packed.reset();
+    }
 
-  void print_constraint_counts(size_t hx=1000, size_t hy=1000)
-  {
-    static const std::string GREEN = "\033[32m";
-    static const std::string RESET = "\033[0m";
+    auto output = args["--output"] ? OutputWriter{args["--output"].asString()} : OutputWriter{};
 
-    for(size_t x = 0; x < SIZE; ++x)
+    switch(*backend)
     {
-      for(size_t y = 0; y < SIZE; ++y)
-      {
-        if(x == hx and y == hy)
+      case Backend::BACKTRACK:
+        if(split)
+        {
+          solve_split(data, num_threads, count, output);
+        }
+        else if(rate)
+        {
+          rate_puzzles(data, num_threads, output);
+        }
+        else if(stats)
         {
-          fmt::print(" {}{}{}", GREEN, get_constraint_count(x, y), RESET);
+          solve_with_stats(data, num_threads, count, output);
+        }
+        else if(packed)
+        {
+          solve_packed<BasicSudokuSolver>(*packed, num_threads, count, output, shared_cache);
         }
         else
         {
-          fmt::print(" {}", get_constraint_count(x, y));
+          solve_puzzles<BasicSudokuSolver>(data, num_threads, count, output, shared_cache);
         }
-      }
-      fmt::print("\n");
+        break;
+      case Backend::DLX:
+        if(packed)
+        {
+          solve_packed<BasicDlxSolver>(*packed, num_threads, count, output, shared_cache);
+        }
+        else
+        {
+          solve_puzzles<BasicDlxSolver>(data, num_threads, count, output, shared_cache);
+        }
+        break;
     }
+    output.flush();
   }
-};
-
-
-static constexpr char USAGE[] =
-R"(solve
-
-    Usage:
-      solve <file>    Input file contain the puzzle.
-    Options:
-      -h --help     Show this screen.
-)";
-
-
-int main(int argc, const char **argv)
-{
-  std::string file_name{};
-  if(argc < 2)
+  catch(const std::exception& e)
   {
-    fmt::print(USAGE);
+    fmt::print(stderr, "{}\n", e.what());
     return 1;
   }
 
-  file_name = argv[1];
-  std::ifstream input{file_name, std::ios_base::in | std::ios_base::binary};
-
-  std::string line;
-  while(std::getline(input, line))
-  {
-    auto solver = SudokuSolver{line};
-
-    if(solver.solve())
-    {
-      solver.print_solution();
-    }
-    else
-    {
-      fmt::print("Failed to find solution\n");
-    }
-  }
-
-
   return 0;
 }
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <fmt/format.h>
+
+
+/**
+ * Collects output in one reusable buffer and hands it to the file in large
+ * writes instead of one stdio call per line. Writes that fail throw a
+ * std::system_error; as the destructor can't report one, owners flush before
+ * they let go of the writer.
+ */
+class OutputWriter
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  // buffered bytes that trigger a write
+  static constexpr std::size_t FLUSH_THRESHOLD = 1 << 20;
+
+  std::FILE* file_{stdout};
+  std::string name_{"stdout"};
+  bool owns_file_{false};
+  fmt::memory_buffer buffer_{};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  [[noreturn]] void fail() const
+  {
+    // stdio doesn't set errno for every failure
+    throw std::system_error(errno ? errno : EIO, std::generic_category(), name_);
+  }
+
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * Write to stdout.
+   */
+  OutputWriter()
+  {
+    buffer_.reserve(2 * FLUSH_THRESHOLD);
+  }
+
+  /**
+   * Write to the file at path, truncating it.
+   */
+  explicit OutputWriter(const std::string& path)
+    : file_{std::fopen(path.c_str(), "wb")}, name_{path}, owns_file_{true}
+  {
+    if(not file_)
+    {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    buffer_.reserve(2 * FLUSH_THRESHOLD);
+  }
+
+  ~OutputWriter()
+  {
+    try
+    {
+      flush();
+    }
+    catch(const std::system_error&)
+    {
+      // only an explicit flush can report the failure
+    }
+
+    if(owns_file_)
+    {
+      std::fclose(file_);
+    }
+  }
+
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator=(const OutputWriter&) = delete;
+
+  void write(std::string_view data)
+  {
+    buffer_.append(data.data(), data.data() + data.size());
+    if(buffer_.size() >= FLUSH_THRESHOLD)
+    {
+      flush();
+    }
+  }
+
+  /**
+   * Hand the buffered output to the file. Throws if it doesn't take all of
+   * it, such as on a full disk.
+   */
+  void flush()
+  {
+    errno = 0;
+    if(buffer_.size())
+    {
+      auto size = buffer_.size();
+      auto written = std::fwrite(buffer_.data(), 1, size, file_);
+      buffer_.clear();
+      if(written != size)
+      {
+        fail();
+      }
+    }
+
+    if(std::fflush(file_) != 0 or std::ferror(file_))
+    {
+      fail();
+    }
+  }
+};
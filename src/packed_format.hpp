@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include "board.hpp"
+#include "grid.hpp"
+
+
+/**
+ * Packed puzzle files store every cell in the fewest bits that hold its value,
+ * 0 for an empty cell and 1 to SIZE for a digit, so a 9x9 puzzle takes 41
+ * bytes instead of a line of 82. Cells go in row-major order, lowest bits
+ * first; every record is padded to whole bytes.
+ *
+ * A file starts with a 16 byte header:
+ *
+ *   bytes 0-3   the magic "SDKP"
+ *   byte 4      format version, 1
+ *   byte 5      box order of the puzzles, 2 to 5
+ *   bytes 6-7   zero
+ *   bytes 8-15  number of puzzles, little endian
+ *
+ * Headerless data holds 9x9 records back to back.
+ */
+static constexpr std::string_view PACKED_MAGIC = "SDKP";
+static constexpr std::uint8_t PACKED_VERSION = 1;
+static constexpr std::size_t PACKED_HEADER_SIZE = 16;
+
+
+/**
+ * Bits needed for the values 0 to max.
+ */
+constexpr std::size_t bits_for(std::size_t max)
+{
+  std::size_t bits = 0;
+  while((std::size_t{1} << bits) <= max)
+  {
+    ++bits;
+  }
+
+  return bits;
+}
+
+
+template <std::size_t Order>
+struct PackedLayout
+{
+  using Shape = Geometry<Order>;
+
+  static constexpr std::size_t CELL_BITS = bits_for(Shape::SIZE);
+  static constexpr std::size_t RECORD_SIZE = (Shape::NUM_CELLS * CELL_BITS + 7) / 8;
+  static constexpr std::uint64_t CELL_MASK = (std::uint64_t{1} << CELL_BITS) - 1;
+};
+
+
+constexpr std::size_t packed_record_size(std::size_t order)
+{
+  switch(order)
+  {
+    case 2:
+      return PackedLayout<2>::RECORD_SIZE;
+    case 3:
+      return PackedLayout<3>::RECORD_SIZE;
+    case 4:
+      return PackedLayout<4>::RECORD_SIZE;
+    case 5:
+      return PackedLayout<5>::RECORD_SIZE;
+  }
+
+  return 0;
+}
+
+
+/**
+ * Append the packed record of the puzzle to out. Throws on puzzles that
+ * don't have exactly NUM_CELLS valid cells.
+ */
+template <std::size_t Order>
+void pack_puzzle(std::string_view puzzle, std::string& out)
+{
+  using Layout = PackedLayout<Order>;
+
+  if(puzzle.size() != Layout::Shape::NUM_CELLS)
+  {
+    auto msg = fmt::format("Puzzle has {} cells instead of {}", puzzle.size(), Layout::Shape::NUM_CELLS);
+    throw std::invalid_argument(msg);
+  }
+
+  std::uint64_t bits = 0;
+  std::size_t num_bits = 0;
+  for(auto value : puzzle)
+  {
+    value = parse_cell<Order>(value);
+    std::uint64_t cell = value == EMPTY_CELL ? 0 : digit_to_idx(value) + 1;
+    bits |= cell << num_bits;
+    num_bits += Layout::CELL_BITS;
+
+    for(; num_bits >= 8; num_bits -= 8, bits >>= 8)
+    {
+      out.push_back(static_cast<char>(bits & 0xFF));
+    }
+  }
+
+  if(num_bits)
+  {
+    out.push_back(static_cast<char>(bits));
+  }
+}
+
+
+/**
+ * Write the NUM_CELLS cells of the packed record to cells as puzzle
+ * characters. Throws on cell values beyond the grid's digits.
+ */
+template <std::size_t Order>
+void unpack_puzzle(std::string_view record, char* cells)
+{
+  using Layout = PackedLayout<Order>;
+  constexpr auto SIZE = Layout::Shape::SIZE;
+
+  auto put = [&](std::size_t cell, std::uint64_t value) {
+    if(value > SIZE)
+    {
+      auto msg = fmt::format("Invalid cell value {} in a packed puzzle", value);
+      throw std::invalid_argument(msg);
+    }
+    cells[cell] = value ? DIGITS[value - 1] : EMPTY_CELL;
+  };
+
+  if constexpr(Layout::CELL_BITS == 4)
+  {
+    // two cells to a byte
+    for(std::size_t cell = 0; cell < Layout::Shape::NUM_CELLS; ++cell)
+    {
+      auto byte = static_cast<std::uint8_t>(record[cell / 2]);
+      put(cell, cell % 2 ? byte >> 4 : byte & 0xF);
+    }
+  }
+  else
+  {
+    std::uint64_t bits = 0;
+    std::size_t num_bits = 0;
+    std::size_t next_byte = 0;
+    for(std::size_t cell = 0; cell < Layout::Shape::NUM_CELLS; ++cell)
+    {
+      for(; num_bits < Layout::CELL_BITS; num_bits += 8)
+      {
+        bits |= std::uint64_t{static_cast<std::uint8_t>(record[next_byte++])} << num_bits;
+      }
+
+      put(cell, bits & Layout::CELL_MASK);
+      bits >>= Layout::CELL_BITS;
+      num_bits -= Layout::CELL_BITS;
+    }
+  }
+}
+
+
+/**
+ * The board of the packed record. The decoder range checks every cell value,
+ * so the board takes the cells without parsing them as characters again.
+ */
+template <std::size_t Order>
+BasicBoard<Order> unpack_board(std::string_view record)
+{
+  grid<char, Geometry<Order>::SIZE> cells{};
+  unpack_puzzle<Order>(record, cells.data());
+  return BasicBoard<Order>{cells};
+}
+
+
+inline void write_packed_header(std::size_t order, std::uint64_t count, std::string& out)
+{
+  out.append(PACKED_MAGIC);
+  out.push_back(static_cast<char>(PACKED_VERSION));
+  out.push_back(static_cast<char>(order));
+  out.append(2, '\0');
+  for(std::size_t byte = 0; byte < 8; ++byte)
+  {
+    out.push_back(static_cast<char>((count >> (8 * byte)) & 0xFF));
+  }
+}
+
+
+/**
+ * The records of a packed file, as views into its data.
+ */
+struct PackedPuzzles
+{
+  std::size_t order{3};
+  std::size_t count{0};
+  std::size_t record_size{PackedLayout<3>::RECORD_SIZE};
+  std::string_view records{};
+
+  std::string_view record(std::size_t i) const
+  {
+    return records.substr(i * record_size, record_size);
+  }
+};
+
+
+inline bool is_packed(std::string_view data)
+{
+  return data.starts_with(PACKED_MAGIC);
+}
+
+
+/**
+ * Find the records in packed data, with or without header. Throws if the
+ * header is damaged or the data doesn't hold whole records.
+ */
+inline PackedPuzzles read_packed(std::string_view data)
+{
+  PackedPuzzles puzzles{};
+
+  if(is_packed(data))
+  {
+    if(data.size() < PACKED_HEADER_SIZE)
+    {
+      throw std::invalid_argument("Truncated packed puzzle header");
+    }
+
+    auto version = static_cast<std::uint8_t>(data[4]);
+    if(version != PACKED_VERSION)
+    {
+      throw std::invalid_argument(fmt::format("Unsupported packed format version {}", version));
+    }
+
+    puzzles.order = static_cast<std::uint8_t>(data[5]);
+    puzzles.record_size = packed_record_size(puzzles.order);
+    if(not puzzles.record_size)
+    {
+      throw std::invalid_argument(fmt::format("Unsupported box order {} in packed puzzles", puzzles.order));
+    }
+
+    std::uint64_t count = 0;
+    for(std::size_t byte = 0; byte < 8; ++byte)
+    {
+      count |= std::uint64_t{static_cast<std::uint8_t>(data[8 + byte])} << (8 * byte);
+    }
+    data.remove_prefix(PACKED_HEADER_SIZE);
+
+    if(count > data.size() / puzzles.record_size)
+    {
+      throw std::invalid_argument(fmt::format("Packed file is short of its {} puzzles", count));
+    }
+    puzzles.count = count;
+    puzzles.records = data.substr(0, puzzles.count * puzzles.record_size);
+    return puzzles;
+  }
+
+  if(data.size() % puzzles.record_size)
+  {
+    throw std::invalid_argument("Packed data doesn't hold whole 9x9 puzzles");
+  }
+  puzzles.count = data.size() / puzzles.record_size;
+  puzzles.records = data;
+  return puzzles;
+}
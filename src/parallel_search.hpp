@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "arena.hpp"
+#include "sudoku_solver.hpp"
+#include "work_stealing_pool.hpp"
+
+
+/**
+ * Searches a single puzzle on several threads. The search tree is split at
+ * its shallow branch points into subproblems - partially filled grids - that
+ * run on a work-stealing pool, each with its own BasicSudokuSolver on the
+ * worker's arena. Workers keep splitting while the pool is short of queued
+ * work and search the subproblem to the end otherwise. All workers give up as
+ * soon as the search is settled: after the first solution, or once the count
+ * reaches its limit.
+ */
+template <std::size_t Order>
+class ParallelSearch
+{
+private: /** ============================= TYPES ============================= **/
+  using Solver = BasicSudokuSolver<Order>;
+
+  // queued subproblems per worker below which tasks split instead of searching
+  static constexpr std::size_t SPLIT_FACTOR = 8;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::string grid_{};
+  std::size_t num_threads_{1};
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * num_threads of 0 means one per core. Throws on puzzles that
+   * BasicSudokuSolver rejects.
+   */
+  explicit ParallelSearch(std::string_view puzzle, std::size_t num_threads = 0)
+    : grid_{Solver{puzzle}.solution()},
+      num_threads_{num_threads ? num_threads : std::max<std::size_t>(std::thread::hardware_concurrency(), 1)}
+  {}
+
+  bool solve()
+  {
+    return count_solutions(1) == 1;
+  }
+
+  /**
+   * Number of solutions of the puzzle, counting no further than limit. The
+   * subproblems' counts are added up; the search stops once they reach limit.
+   * With a limit of 1 the grid holds the solution afterwards.
+   */
+  std::size_t count_solutions(std::size_t limit)
+  {
+    if(limit == 0)
+    {
+      return 0;
+    }
+
+    WorkStealingPool<std::string> pool{num_threads_};
+    // cancels the searches of every worker once the count is settled
+    std::stop_source stop{};
+    Budget budget{};
+    budget.stop = stop.get_token();
+    std::atomic<std::size_t> count{0};
+
+    // only the worker that settles the search gets to keep its solution; one
+    // that found nothing can't settle it, even when the others just did
+    auto record = [&](std::size_t found, const Solver& solver, bool holds_solution) {
+      if(not found)
+      {
+        return;
+      }
+
+      auto total = count.fetch_add(found) + found;
+      if(total < limit or not stop.request_stop())
+      {
+        return;
+      }
+
+      if(holds_solution)
+      {
+        grid_ = solver.solution();
+      }
+    };
+
+    pool.push(0, grid_);
+    pool.run([&](std::size_t worker, const std::string& grid) {
+      if(stop.stop_requested())
+      {
+        return;
+      }
+
+      ArenaScope scope{thread_arena()};
+      Solver solver{grid, &scope.arena()};
+      if(pool.pending() < SPLIT_FACTOR * pool.num_workers())
+      {
+        auto state = solver.branch([&](std::string_view subproblem) { pool.push(worker, std::string{subproblem}); });
+        bool solved = state == GameState::SOLVED;
+        record(solved, solver, solved);
+        return;
+      }
+
+      // a count short of remaining leaves the grid rolled back, a cancelled one
+      // finds nothing
+      auto remaining = limit - std::min(count.load(), limit);
+      auto found = remaining ? solver.count_solutions(remaining, budget).value_or(0) : 0;
+      record(found, solver, found and found == remaining);
+    });
+
+    return std::min(count.load(), limit);
+  }
+
+  /**
+   * True if the puzzle has exactly one solution. The search stops at the
+   * second one.
+   */
+  bool is_unique()
+  {
+    return count_solutions(2) == 1;
+  }
+
+  /**
+   * The grid as a string of NUM_CELLS digits, filled in once solve() succeeds.
+   */
+  std::string_view solution() const
+  {
+    return grid_;
+  }
+
+  void print_solution()
+  {
+    fmt::print("{}\n", solution());
+  }
+};
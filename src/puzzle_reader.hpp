@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SUDOKU_HAS_MMAP 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * Read-only view of a whole file. Where mmap is available the file is mapped
+ * into memory, otherwise it is read into a buffer once.
+ */
+class MappedFile
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  const char* data_{nullptr};
+  std::size_t size_{0};
+#ifndef SUDOKU_HAS_MMAP
+  std::string buffer_{};
+#endif
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit MappedFile(const std::string& path)
+  {
+#ifdef SUDOKU_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+
+    struct stat info{};
+    if(::fstat(fd, &info) != 0)
+    {
+      auto error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+
+    size_ = static_cast<std::size_t>(info.st_size);
+    if(size_ > 0)
+    {
+      void* address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(address == MAP_FAILED)
+      {
+        auto error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+
+      ::madvise(address, size_, MADV_SEQUENTIAL);
+      data_ = static_cast<const char*>(address);
+    }
+
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+#else
+    std::ifstream input{path, std::ios_base::in | std::ios_base::binary};
+    if(not input)
+    {
+      throw std::runtime_error(path + ": cannot open file");
+    }
+
+    buffer_.assign(std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{});
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+  }
+
+  ~MappedFile()
+  {
+#ifdef SUDOKU_HAS_MMAP
+    if(data_)
+    {
+      ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string_view view() const
+  {
+    return {data_, size_};
+  }
+};
+
+
+/**
+ * Splits a buffer into puzzle records, one per line, without copying them.
+ * Both "\n" and "\r\n" line endings are accepted and blank lines are skipped.
+ */
+class RecordReader
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  std::string_view data_{};
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit RecordReader(std::string_view data)
+    : data_{data}
+  {}
+
+  /**
+   * Store the next record in record. Returns false once the buffer is used up.
+   */
+  bool next(std::string_view& record)
+  {
+    while(not data_.empty())
+    {
+      auto end = data_.find('\n');
+      auto line = data_.substr(0, end);
+      data_.remove_prefix(end == std::string_view::npos ? data_.size() : end + 1);
+
+      if(not line.empty() and line.back() == '\r')
+      {
+        line.remove_suffix(1);
+      }
+
+      if(not line.empty())
+      {
+        record = line;
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
+
+
+/**
+ * Reads a stream of puzzle lines - a pipe, a socket or a terminal - in blocks
+ * of whole lines, handing each block out as soon as it has arrived instead of
+ * waiting for the end of the input. A line split across reads is held back
+ * until its end comes in; the last line needs no line break.
+ */
+class StreamReader
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  // bytes asked for per read
+  static constexpr std::size_t BLOCK_SIZE = 1 << 16;
+  // longest line held back; no puzzle comes close
+  static constexpr std::size_t MAX_LINE_SIZE = 1 << 20;
+  // how often a reader waiting for input checks the stop flag
+  static constexpr int POLL_MILLISECONDS = 100;
+
+#ifdef SUDOKU_HAS_MMAP
+  int fd_{STDIN_FILENO};
+#endif
+  std::string partial_{};
+  bool done_{false};
+  std::stop_token stop_{};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  /**
+   * Append what the stream has to offer, up to BLOCK_SIZE bytes, to buffer.
+   * Returns the number of bytes, 0 at the end of the stream or once stopped.
+   */
+  std::size_t read_some(std::string& buffer)
+  {
+    auto old_size = buffer.size();
+    buffer.resize(old_size + BLOCK_SIZE);
+    std::size_t size = 0;
+
+#ifdef SUDOKU_HAS_MMAP
+    for(;;)
+    {
+      if(stop_.stop_requested())
+      {
+        break;
+      }
+
+      pollfd request{fd_, POLLIN, 0};
+      auto ready = ::poll(&request, 1, POLL_MILLISECONDS);
+      if(ready < 0 and errno != EINTR)
+      {
+        throw std::system_error(errno, std::generic_category(), "poll");
+      }
+      else if(ready <= 0)
+      {
+        continue;
+      }
+
+      auto got = ::read(fd_, buffer.data() + old_size, BLOCK_SIZE);
+      if(got < 0 and errno != EINTR)
+      {
+        throw std::system_error(errno, std::generic_category(), "read");
+      }
+      else if(got >= 0)
+      {
+        size = static_cast<std::size_t>(got);
+        break;
+      }
+    }
+#else
+    // stdio blocks until the buffer is full, so blocks arrive less promptly
+    size = std::fread(buffer.data() + old_size, 1, BLOCK_SIZE, stdin);
+#endif
+
+    buffer.resize(old_size + size);
+    return size;
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+#ifdef SUDOKU_HAS_MMAP
+  /**
+   * Read from the file descriptor, stdin by default. The descriptor stays open.
+   */
+  explicit StreamReader(int fd = STDIN_FILENO)
+    : fd_{fd}
+  {}
+#else
+  /**
+   * Read from stdin.
+   */
+  StreamReader() = default;
+#endif
+
+  /**
+   * Stop reading once a stop is requested, even if no input arrives.
+   */
+  void stop_when(std::stop_token stop)
+  {
+    stop_ = std::move(stop);
+  }
+
+  /**
+   * Replace block with the next run of complete lines, each ending in a line
+   * break but for the last line of the stream. Returns false at the end.
+   */
+  bool next(std::string& block)
+  {
+    block.clear();
+    while(not done_)
+    {
+      block.swap(partial_);
+      if(read_some(block) == 0)
+      {
+        done_ = true;
+        partial_.clear();
+        return not block.empty();
+      }
+
+      auto end = block.rfind('\n');
+      if(end != std::string::npos)
+      {
+        partial_.assign(block, end + 1);
+        block.resize(end + 1);
+        return true;
+      }
+
+      // no line ended in this read, keep collecting
+      if(block.size() > MAX_LINE_SIZE)
+      {
+        throw std::range_error("Line too long in the input stream");
+      }
+      block.swap(partial_);
+      block.clear();
+    }
+
+    return false;
+  }
+};
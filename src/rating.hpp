@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "search_budget.hpp"
+
+
+/**
+ * Logical techniques a human solver uses, from the easiest to the hardest.
+ * SEARCH stands for having to guess once none of the others gets further.
+ */
+enum class Technique
+{
+  NONE = 0,
+  HIDDEN_SINGLE = 1,
+  NAKED_SINGLE = 2,
+  LOCKED_CANDIDATES = 3,
+  NAKED_PAIR = 4,
+  HIDDEN_PAIR = 5,
+  NAKED_TRIPLE = 6,
+  HIDDEN_TRIPLE = 7,
+  X_WING = 8,
+  SWORDFISH = 9,
+  SEARCH = 10,
+};
+
+
+static constexpr std::array<std::string_view, 11> TECHNIQUE_NAMES = {"none",
+  "hidden-single",
+  "naked-single",
+  "locked-candidates",
+  "naked-pair",
+  "hidden-pair",
+  "naked-triple",
+  "hidden-triple",
+  "x-wing",
+  "swordfish",
+  "search"};
+
+// what a step with each technique adds to the score
+static constexpr std::array<std::size_t, 11> TECHNIQUE_WEIGHTS = {0, 1, 2, 4, 6, 7, 8, 9, 10, 12, 50};
+
+
+constexpr std::string_view technique_name(Technique technique)
+{
+  return TECHNIQUE_NAMES[static_cast<std::size_t>(technique)];
+}
+
+
+/**
+ * How hard a puzzle is for a human: the hardest technique it needs and a
+ * score that adds up the weights of the techniques of every step. A step is
+ * one pass of the easiest technique that still gets further. The state is
+ * SOLVED if the techniques fill the grid, VALID if they get stuck, which
+ * counts as a SEARCH step, and the reason if the puzzle has no solution.
+ */
+struct Rating
+{
+  GameState state{GameState::VALID};
+  Technique hardest{Technique::NONE};
+  std::size_t score{0};
+  std::size_t steps{0};
+
+  void add_step(Technique technique)
+  {
+    hardest = std::max(hardest, technique);
+    score += TECHNIQUE_WEIGHTS[static_cast<std::size_t>(technique)];
+    ++steps;
+  }
+};
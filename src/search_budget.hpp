@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stop_token>
+#include <utility>
+
+
+enum class GameState
+{
+  SOLVED = 1,
+  VIOLATION = 2,
+  VALID = 3,
+  NO_CHOICES_FOR_EMPTY_CELL = 4,
+  TIMED_OUT = 5, // the search ran out of budget before it was settled
+};
+
+
+/**
+ * How much search one solve may spend: a number of search nodes, a point in
+ * time, and a token to cancel it with. Any of them ends the search once it
+ * runs out; the default budget never does.
+ */
+struct Budget
+{
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::uint64_t UNLIMITED = std::numeric_limits<std::uint64_t>::max();
+
+  std::uint64_t max_nodes{UNLIMITED};
+  std::optional<Clock::time_point> deadline{};
+  std::stop_token stop{};
+
+  /**
+   * A budget that runs out time from now.
+   */
+  static Budget within(Clock::duration time)
+  {
+    Budget budget{};
+    budget.deadline = Clock::now() + time;
+    return budget;
+  }
+};
+
+
+/**
+ * Spends a budget one search node at a time. The node count is checked on
+ * every node, the clock and the stop token only every CHECK_INTERVAL nodes,
+ * so a search costs an increment and a compare per node. A default meter has
+ * no budget to check at all.
+ */
+class BudgetMeter
+{
+private: /** ============================= TYPES ============================= **/
+  static constexpr std::uint64_t CHECK_INTERVAL = 4096;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  Budget budget_{};
+  std::uint64_t nodes_{0};
+  // spend() looks at the budget again once more nodes than this are spent
+  std::uint64_t next_check_{Budget::UNLIMITED};
+  bool exhausted_{false};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  bool check()
+  {
+    if(not exhausted_)
+    {
+      exhausted_ = nodes_ > budget_.max_nodes or budget_.stop.stop_requested()
+        or (budget_.deadline and Budget::Clock::now() >= *budget_.deadline);
+    }
+
+    if(exhausted_)
+    {
+      next_check_ = 0;
+      return false;
+    }
+
+    next_check_ = std::min(nodes_ + CHECK_INTERVAL, budget_.max_nodes);
+    return true;
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  BudgetMeter() = default;
+
+  /**
+   * The first node already checks the budget, so a search that is cancelled
+   * or late before it starts gives up right away.
+   */
+  explicit BudgetMeter(Budget budget)
+    : budget_{std::move(budget)}, next_check_{0}
+  {}
+
+  /**
+   * Take one node from the budget. Returns false, now and on every later
+   * call, once the budget has run out.
+   */
+  bool spend()
+  {
+    return ++nodes_ <= next_check_ or check();
+  }
+
+  bool exhausted() const
+  {
+    return exhausted_;
+  }
+
+  std::uint64_t nodes() const
+  {
+    return nodes_;
+  }
+};
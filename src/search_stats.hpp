@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+
+/**
+ * Stats policy of BasicSudokuSolver that records nothing. Every hook is an
+ * empty inline function, so a solver built with it runs the same code as one
+ * without any hooks.
+ */
+struct NoStats
+{
+  static constexpr bool ENABLED = false;
+
+  struct Timer
+  {};
+
+  Timer time() { return {}; }
+  void branch_point(std::size_t) {}
+  void guess() {}
+  void backtrack() {}
+  void propagation_round() {}
+};
+
+
+/**
+ * Stats policy of BasicSudokuSolver that counts what the search did, summed
+ * over every solve() and count_solutions() call of the solver.
+ */
+struct SearchStats
+{
+  static constexpr bool ENABLED = true;
+
+  /**
+   * Adds the wall time from its construction to its destruction to the stats.
+   */
+  class Timer
+  {
+  private: /** ============================= MEMBER VARS ============================= **/
+    SearchStats& stats_;
+    std::chrono::steady_clock::time_point start_;
+
+  public: /** ============================= MEMBER METHODS ============================= **/
+    explicit Timer(SearchStats& stats)
+      : stats_{stats}, start_{std::chrono::steady_clock::now()}
+    {}
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    ~Timer()
+    {
+      stats_.time_spent += std::chrono::steady_clock::now() - start_;
+    }
+  };
+
+  std::size_t nodes{0};        // branch points: cells the search had to guess at
+  std::size_t guesses{0};      // digits tried at branch points
+  std::size_t backtracks{0};   // guesses that ran into a contradiction
+  std::size_t propagations{0}; // rounds of the propagation fixpoint loop
+  std::size_t max_depth{0};    // most guesses open at the same time
+  std::chrono::nanoseconds time_spent{0};
+
+  Timer time()
+  {
+    return Timer{*this};
+  }
+
+  void branch_point(std::size_t depth)
+  {
+    ++nodes;
+    max_depth = std::max(max_depth, depth);
+  }
+
+  void guess()
+  {
+    ++guesses;
+  }
+
+  void backtrack()
+  {
+    ++backtracks;
+  }
+
+  void propagation_round()
+  {
+    ++propagations;
+  }
+};
+
+
+/**
+ * Aggregate of the stats of many puzzles: totals, and histograms of the
+ * nodes and the time per puzzle in power of two buckets.
+ */
+class StatsSummary
+{
+public: /** ============================= TYPES ============================= **/
+  // bucket i holds values v with 2^(i-1) <= v < 2^i, bucket 0 holds 0
+  static constexpr std::size_t NUM_BUCKETS = 40;
+  using Histogram = std::array<std::size_t, NUM_BUCKETS>;
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::size_t puzzles_{0};
+  SearchStats total_{};
+  Histogram nodes_{};
+  Histogram micros_{};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  static std::size_t bucket(std::size_t value)
+  {
+    auto width = static_cast<std::size_t>(std::numeric_limits<std::size_t>::digits - std::countl_zero(value));
+    return std::min(width, NUM_BUCKETS - 1);
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  void add(const SearchStats& stats)
+  {
+    ++puzzles_;
+    total_.nodes += stats.nodes;
+    total_.guesses += stats.guesses;
+    total_.backtracks += stats.backtracks;
+    total_.propagations += stats.propagations;
+    total_.max_depth = std::max(total_.max_depth, stats.max_depth);
+    total_.time_spent += stats.time_spent;
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(stats.time_spent).count();
+    ++nodes_[bucket(stats.nodes)];
+    ++micros_[bucket(static_cast<std::size_t>(std::max<decltype(micros)>(micros, 0)))];
+  }
+
+  std::size_t puzzles() const
+  {
+    return puzzles_;
+  }
+
+  /**
+   * Sums over all puzzles, except for max_depth, the deepest of any puzzle.
+   */
+  const SearchStats& total() const
+  {
+    return total_;
+  }
+
+  const Histogram& nodes() const
+  {
+    return nodes_;
+  }
+
+  /**
+   * Wall time per puzzle in microseconds.
+   */
+  const Histogram& micros() const
+  {
+    return micros_;
+  }
+
+  /**
+   * Smallest value that lands in the bucket.
+   */
+  static std::size_t bucket_floor(std::size_t i)
+  {
+    return i ? std::size_t{1} << (i - 1) : 0;
+  }
+};
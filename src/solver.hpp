@@ -0,0 +1,86 @@
+#pragma once
+
+#include <concepts>
+#include <optional>
+#include <string_view>
+
+#include "dlx_solver.hpp"
+#include "parallel_search.hpp"
+#include "sudoku_solver.hpp"
+
+
+/**
+ * What every search engine offers so that the front end can drive any of them.
+ */
+template <typename T>
+concept Solver = std::constructible_from<T, std::string_view> and requires(T solver)
+{
+  { solver.solve() } -> std::same_as<bool>;
+  { solver.count_solutions(std::size_t{}) } -> std::same_as<std::size_t>;
+  { solver.is_unique() } -> std::same_as<bool>;
+  { solver.solution() } -> std::convertible_to<std::string_view>;
+  solver.print_solution();
+};
+
+static_assert(Solver<BasicSudokuSolver<2>> and Solver<BasicSudokuSolver<3>>);
+static_assert(Solver<BasicSudokuSolver<4>> and Solver<BasicSudokuSolver<5>>);
+static_assert(Solver<BasicDlxSolver<2>> and Solver<BasicDlxSolver<3>>);
+static_assert(Solver<BasicDlxSolver<4>> and Solver<BasicDlxSolver<5>>);
+static_assert(Solver<ParallelSearch<2>> and Solver<ParallelSearch<3>>);
+static_assert(Solver<ParallelSearch<4>> and Solver<ParallelSearch<5>>);
+
+
+/**
+ * Build the engine specialized for the grid the puzzle's length calls for and
+ * hand it to fn. Lines of any other length are read as 9x9 puzzles. Any
+ * further arguments go to the engine's constructor after the puzzle.
+ */
+template <template <std::size_t> class Engine, typename Fn, typename... Args>
+decltype(auto) with_solver(std::string_view puzzle, Fn&& fn, const Args&... args)
+{
+  switch(order_for_cells(puzzle.size()))
+  {
+    case 2:
+    {
+      Engine<2> solver{puzzle, args...};
+      return fn(solver);
+    }
+    case 4:
+    {
+      Engine<4> solver{puzzle, args...};
+      return fn(solver);
+    }
+    case 5:
+    {
+      Engine<5> solver{puzzle, args...};
+      return fn(solver);
+    }
+    default:
+    {
+      Engine<3> solver{puzzle, args...};
+      return fn(solver);
+    }
+  }
+}
+
+
+enum class Backend
+{
+  BACKTRACK = 1, // BasicSudokuSolver: propagation plus backtracking
+  DLX = 2,       // BasicDlxSolver: exact cover with Dancing Links
+};
+
+
+inline std::optional<Backend> parse_backend(std::string_view name)
+{
+  if(name == "backtrack")
+  {
+    return Backend::BACKTRACK;
+  }
+  else if(name == "dlx")
+  {
+    return Backend::DLX;
+  }
+
+  return std::nullopt;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "output_writer.hpp"
+#include "puzzle_reader.hpp"
+
+
+/**
+ * A run of input lines or answer lines, numbered in input order.
+ */
+struct StreamChunk
+{
+  std::size_t sequence{0};
+  std::string text{};
+};
+
+
+/**
+ * Solve the puzzles of a stream as they arrive, in three stages connected by
+ * bounded queues:
+ *
+ * - a reader thread cuts the input into chunks of up to BATCH_CHUNK_SIZE lines
+ *   and queues them;
+ * - num_threads workers take chunks off that queue and queue the answers;
+ * - the calling thread puts the answers back into input order and writes them.
+ *
+ * At most a few chunks per worker are read but not yet written at any time:
+ * the reader waits for the writer when it gets that far ahead, so a slow
+ * chunk holds up the input instead of letting the answers behind it pile up.
+ * Memory stays bounded however long the stream is. The output is flushed whenever the
+ * writer catches up with the workers, so every answer goes out shortly after
+ * its puzzle came in. An exception in any stage or in writing the output
+ * stops the pipeline and is rethrown here. The workers share the cache, if
+ * there is one.
+ */
+template <template <std::size_t> class Engine>
+void solve_stream(StreamReader& reader,
+  std::size_t num_threads,
+  std::optional<std::size_t> count,
+  OutputWriter& output,
+  SolutionCache* cache = nullptr)
+{
+  // chunks queued per worker in either direction
+  static constexpr std::size_t CHUNKS_PER_WORKER = 4;
+
+  num_threads = std::max<std::size_t>(num_threads, 1);
+  BoundedQueue<StreamChunk> puzzles{CHUNKS_PER_WORKER * num_threads};
+  BoundedQueue<StreamChunk> answers{CHUNKS_PER_WORKER * num_threads};
+
+  // chunks read but not written yet, counting the one the writer waits for
+  const auto window = CHUNKS_PER_WORKER * num_threads;
+  std::atomic<std::size_t> next{0};
+  std::mutex window_mutex{};
+  std::condition_variable window_moved{};
+
+  std::stop_source stop{};
+  std::exception_ptr error{};
+  std::mutex error_mutex{};
+  auto fail = [&]() {
+    {
+      std::lock_guard lock{error_mutex};
+      if(not error)
+      {
+        error = std::current_exception();
+      }
+    }
+
+    std::lock_guard lock{window_mutex};
+    stop.request_stop();
+    window_moved.notify_all();
+  };
+
+  reader.stop_when(stop.get_token());
+  std::thread read_stage{[&]() {
+    try
+    {
+      std::size_t sequence = 0;
+      for(std::string block; not stop.stop_requested() and reader.next(block);)
+      {
+        std::string_view rest{block};
+        while(not rest.empty())
+        {
+          // cut after the BATCH_CHUNK_SIZE-th line break, or take the rest
+          std::size_t end = 0;
+          for(std::size_t lines = 0; lines < BATCH_CHUNK_SIZE and end < rest.size(); ++lines)
+          {
+            end = std::min(rest.find('\n', end), rest.size() - 1) + 1;
+          }
+
+          {
+            std::unique_lock lock{window_mutex};
+            window_moved.wait(lock, [&]() { return stop.stop_requested() or sequence - next < window; });
+          }
+
+          if(stop.stop_requested() or not puzzles.push({sequence++, std::string{rest.substr(0, end)}}))
+          {
+            break;
+          }
+          rest.remove_prefix(end);
+        }
+      }
+    }
+    catch(...)
+    {
+      fail();
+    }
+    puzzles.close();
+  }};
+
+  std::atomic<std::size_t> running{num_threads};
+  std::vector<std::thread> solve_stage{};
+  solve_stage.reserve(num_threads);
+  for(std::size_t t = 0; t < num_threads; ++t)
+  {
+    solve_stage.emplace_back([&]() {
+      try
+      {
+        std::vector<std::string_view> records{};
+        for(StreamChunk chunk{}; not stop.stop_requested() and puzzles.pop(chunk);)
+        {
+          records.clear();
+          RecordReader lines{chunk.text};
+          for(std::string_view record; lines.next(record);)
+          {
+            records.push_back(record);
+          }
+
+          std::string out{};
+          solve_chunk<Engine>(std::span<const std::string_view>{records}, count, out, cache);
+          answers.push({chunk.sequence, std::move(out)});
+        }
+      }
+      catch(...)
+      {
+        fail();
+        // let the reader see the stop instead of waiting for room
+        puzzles.close();
+      }
+
+      if(--running == 0)
+      {
+        answers.close();
+      }
+    });
+  }
+
+  // a failed write stops the pipeline like a failed stage; after a failure
+  // the answers are drained so the workers can finish
+  auto emit = [&](auto&& step) {
+    if(stop.stop_requested())
+    {
+      return;
+    }
+
+    try
+    {
+      step();
+    }
+    catch(...)
+    {
+      fail();
+      puzzles.close();
+    }
+  };
+
+  // answers that came in ahead of the next one due, fewer than the window
+  std::map<std::size_t, std::string> ahead{};
+  for(StreamChunk chunk{};;)
+  {
+    if(not answers.try_pop(chunk))
+    {
+      // caught up with the workers: send off what is there before waiting
+      emit([&]() { output.flush(); });
+      if(not answers.pop(chunk))
+      {
+        break;
+      }
+    }
+
+    emit([&]() {
+      ahead.emplace(chunk.sequence, std::move(chunk.text));
+      auto first = next.load();
+      for(auto it = ahead.begin(); it != ahead.end() and it->first == next; it = ahead.erase(it), ++next)
+      {
+        output.write(it->second);
+      }
+
+      if(next != first)
+      {
+        std::lock_guard lock{window_mutex};
+        window_moved.notify_all();
+      }
+    });
+  }
+
+  read_stage.join();
+  for(auto& thread : solve_stage)
+  {
+    thread.join();
+  }
+
+  if(error)
+  {
+    std::rethrow_exception(error);
+  }
+}
@@ -0,0 +1,155 @@
+#include "sudoku.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include "arena.hpp"
+#include "batch.hpp"
+
+
+namespace {
+static_assert(SUDOKU_CELLS == Geometry<3>::NUM_CELLS);
+
+/**
+ * Solve the records first to last - 1 straight into their places in out,
+ * noting what became of each in status if there is one. Groups of puzzles
+ * run singles propagation in lockstep first where the lanes are available,
+ * like solve_lanes(). Returns the number of puzzles solved.
+ */
+std::size_t solve_records(const char* puzzles, std::size_t first, std::size_t last, char* out, unsigned char* status)
+{
+  constexpr auto NUM_CELLS = Geometry<3>::NUM_CELLS;
+
+  std::size_t solved = 0;
+  auto answer = [&](std::size_t k, unsigned char result, std::string_view solution) {
+    auto* cells = out + k * NUM_CELLS;
+    if(result == SUDOKU_SOLVED)
+    {
+      std::copy(solution.begin(), solution.end(), cells);
+      ++solved;
+    }
+    else
+    {
+      std::fill_n(cells, NUM_CELLS, EMPTY_CELL);
+    }
+
+    if(status)
+    {
+      status[k] = result;
+    }
+  };
+
+  ArenaScope scope{thread_arena()};
+  // reloaded for every puzzle left to the search
+  BasicSudokuSolver<3> solver{Board{}, &scope.arena()};
+  auto search = [&](std::size_t k, const Board& board) {
+    solver.load(board);
+    auto result = solver.solve() ? SUDOKU_SOLVED : SUDOKU_UNSOLVABLE;
+    answer(k, static_cast<unsigned char>(result), solver.solution());
+  };
+
+#ifdef SUDOKU_HAS_LANES
+  LanePropagator lanes{};
+  std::array<std::size_t, LanePropagator::LANES> group{};
+  std::size_t group_size = 0;
+  auto flush_group = [&]() {
+    lanes.propagate();
+    for(std::size_t lane = 0; lane < group_size; ++lane)
+    {
+      Board grid{lanes.cells(lane)};
+      if(lanes.solved(lane))
+      {
+        answer(group[lane], SUDOKU_SOLVED, grid.view());
+      }
+      else if(lanes.failed(lane))
+      {
+        answer(group[lane], SUDOKU_UNSOLVABLE, {});
+      }
+      else
+      {
+        search(group[lane], grid);
+      }
+    }
+
+    lanes = LanePropagator{};
+    group_size = 0;
+  };
+#endif
+
+  for(auto k = first; k < last; ++k)
+  {
+    Board board{};
+    try
+    {
+      board = Board{std::string_view{puzzles + k * NUM_CELLS, NUM_CELLS}};
+    }
+    catch(const std::invalid_argument&)
+    {
+      // the record holds a character that is neither a digit nor an empty cell
+      answer(k, SUDOKU_INVALID, {});
+      continue;
+    }
+
+#ifdef SUDOKU_HAS_LANES
+    group[group_size] = k;
+    lanes.load(group_size++, board);
+    if(group_size == LanePropagator::LANES)
+    {
+      flush_group();
+    }
+#else
+    search(k, board);
+#endif
+  }
+
+#ifdef SUDOKU_HAS_LANES
+  if(group_size)
+  {
+    flush_group();
+  }
+#endif
+
+  return solved;
+}
+}// namespace
+
+
+extern "C" ptrdiff_t sudoku_solve_batch(const char* puzzles, size_t n, char* out)
+{
+  return sudoku_solve_batch_status(puzzles, n, out, nullptr, 1);
+}
+
+
+extern "C" ptrdiff_t sudoku_solve_batch_parallel(const char* puzzles, size_t n, char* out, size_t num_threads)
+{
+  return sudoku_solve_batch_status(puzzles, n, out, nullptr, num_threads);
+}
+
+
+extern "C" ptrdiff_t sudoku_solve_batch_status(const char* puzzles,
+  size_t n,
+  char* out,
+  unsigned char* status,
+  size_t num_threads)
+{
+  // nothing may leave through the C interface
+  try
+  {
+    std::atomic<std::size_t> solved{0};
+    auto num_chunks = (n + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+    run_tasks(num_chunks, num_threads ? num_threads : std::thread::hardware_concurrency(), [&](std::size_t i) {
+      auto first = i * BATCH_CHUNK_SIZE;
+      solved += solve_records(puzzles, first, std::min(first + BATCH_CHUNK_SIZE, n), out, status);
+    });
+    return static_cast<ptrdiff_t>(solved.load());
+  }
+  catch(...)
+  {
+    return -1;
+  }
+}
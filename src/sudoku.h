@@ -0,0 +1,65 @@
+#ifndef SUDOKU_H
+#define SUDOKU_H
+
+#include <stddef.h>
+
+#if defined(_WIN32) && defined(SUDOKU_SHARED)
+#ifdef SUDOKU_BUILDING
+#define SUDOKU_API __declspec(dllexport)
+#else
+#define SUDOKU_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define SUDOKU_API __attribute__((visibility("default")))
+#else
+#define SUDOKU_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Cells of a 9x9 puzzle record, row by row: '1' to '9' for digits, '0' or
+ * '.' for empty cells.
+ */
+#define SUDOKU_CELLS 81
+
+/**
+ * What became of a puzzle, as sudoku_solve_batch_status() reports it.
+ */
+#define SUDOKU_SOLVED 0     /* its solution is in out */
+#define SUDOKU_UNSOLVABLE 1 /* the puzzle has no solution */
+#define SUDOKU_INVALID 2    /* a character is neither a digit nor an empty cell */
+
+/**
+ * Solve the n puzzles stored back to back in puzzles, SUDOKU_CELLS characters
+ * each, and write their solutions the same way to out, which must have room
+ * for n * SUDOKU_CELLS characters. A puzzle without solution, or an invalid
+ * one, gets a record of '0's. Returns the number of puzzles solved, or -1 if
+ * memory ran out; out holds nothing useful then.
+ */
+SUDOKU_API ptrdiff_t sudoku_solve_batch(const char* puzzles, size_t n, char* out);
+
+/**
+ * Like sudoku_solve_batch() on num_threads worker threads, the calling thread
+ * among them; 0 starts one per core.
+ */
+SUDOKU_API ptrdiff_t sudoku_solve_batch_parallel(const char* puzzles, size_t n, char* out, size_t num_threads);
+
+/**
+ * Like sudoku_solve_batch_parallel(), also writing one of SUDOKU_SOLVED,
+ * SUDOKU_UNSOLVABLE or SUDOKU_INVALID for puzzle k to status[k] unless status
+ * is NULL.
+ */
+SUDOKU_API ptrdiff_t sudoku_solve_batch_status(const char* puzzles,
+  size_t n,
+  char* out,
+  unsigned char* status,
+  size_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
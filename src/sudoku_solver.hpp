@@ -0,0 +1,1177 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "board.hpp"
+#include "grid.hpp"
+#include "rating.hpp"
+#include "search_budget.hpp"
+#include "search_stats.hpp"
+#include "unit_scan.hpp"
+
+
+/**
+ * How the search picks the next empty cell to branch on.
+ */
+enum class Branching
+{
+  ROW_ORDER = 1,  // first empty cell in row-major order
+  MRV = 2,        // empty cell with the fewest candidates
+  MRV_DEGREE = 3, // like MRV, ties go to the cell with the most empty peers
+};
+
+
+/**
+ * Logical deductions applied to a fixpoint before every branching decision.
+ */
+enum class Propagation
+{
+  NONE = 1,              // only strike placed digits from the peers
+  SINGLES = 2,           // naked singles and hidden singles in rows, columns and boxes
+  LOCKED_CANDIDATES = 3, // singles plus pointing and claiming
+};
+
+
+/**
+ * Constraint propagation plus backtracking for grids of the given box order.
+ * Stats is told about every step of the search; with NoStats, the default, the
+ * hooks compile to nothing.
+ */
+template <std::size_t Order, typename Stats = NoStats>
+class BasicSudokuSolver
+{
+private: /** ============================= TYPES ============================= **/
+  using Shape = Geometry<Order>;
+  using CandidateMask = typename Shape::Mask;
+  using CellIndex = typename Shape::CellIndex;
+
+  static constexpr std::size_t ORDER = Shape::ORDER;
+  static constexpr std::size_t SIZE = Shape::SIZE;
+  static constexpr std::size_t NUM_CELLS = Shape::NUM_CELLS;
+  static constexpr CandidateMask ALL_DIGITS = Shape::ALL_DIGITS;
+
+  // every empty cell takes one placement and at most SIZE - 1 eliminations
+  static constexpr std::size_t MAX_TRAIL_SIZE = NUM_CELLS * SIZE;
+  static_assert(MAX_TRAIL_SIZE <= UINT16_MAX);
+
+  // for every unit and digit the cells of the unit the digit fits in, see digit_places()
+  using DigitPlaces = std::array<std::array<CandidateMask, SIZE>, Shape::NUM_UNITS>;
+
+  /**
+   * A single change to the solver state, recorded so the search can roll it back.
+   */
+  struct TrailEntry
+  {
+    CellIndex cell;
+    bool placed;              // true if a digit was put into the cell, false if candidates were removed
+    CandidateMask candidates; // candidates of the cell before the change
+  };
+
+  /**
+   * A branching decision of the search: the cell guessed at, the candidates not
+   * tried yet, and the trail size to roll back to before the next guess.
+   */
+  struct DecisionFrame
+  {
+    CellIndex cell;
+    CandidateMask remaining;
+    std::uint16_t mark;
+  };
+
+private: /** ============================= MEMBER VARS ============================= **/
+  // the puzzle as loaded, for reset()
+  BasicBoard<Order> puzzle_{};
+  grid<char, SIZE> grid_{};
+  grid<CandidateMask, SIZE> candidates_{};
+  std::array<CandidateMask, SIZE> row_digits_{};
+  std::array<CandidateMask, SIZE> col_digits_{};
+  std::array<CandidateMask, SIZE> box_digits_{};
+  std::pmr::vector<TrailEntry> trail_;
+  // at most one guess per cell is ever open
+  std::array<DecisionFrame, NUM_CELLS> decisions_{};
+  size_t depth_{0};
+  Branching branching_{Branching::MRV};
+  Propagation propagation_{Propagation::SINGLES};
+  // what the running solve may still spend
+  BudgetMeter meter_{};
+  [[no_unique_address]] Stats stats_{};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  // unchecked accessors for the inner loops
+  inline char& value_at(std::size_t x, std::size_t y)
+  {
+    return get_cell(x, y, grid_);
+  }
+
+  inline CandidateMask& candidates_at(std::size_t x, std::size_t y)
+  {
+    return get_cell(x, y, candidates_);
+  }
+
+  inline char& value_at(std::size_t cell)
+  {
+    return grid_[cell];
+  }
+
+  inline CandidateMask& candidates_at(std::size_t cell)
+  {
+    return candidates_[cell];
+  }
+
+  inline size_t candidate_count(std::size_t x, std::size_t y)
+  {
+    return static_cast<size_t>(std::popcount(candidates_at(x, y)));
+  }
+
+  /**
+   * Collect the digits already used by every row, column and box and work out
+   * the candidates of every cell from them.
+   */
+  void update_constraints()
+  {
+    auto scan = scan_grid<Order>(grid_, candidates_);
+
+    auto first = scan.digits.begin();
+    std::copy(first, first + SIZE, row_digits_.begin());
+    std::copy(first + SIZE, first + 2 * SIZE, col_digits_.begin());
+    std::copy(first + 2 * SIZE, scan.digits.end(), box_digits_.begin());
+  }
+
+  /**
+   * Put the digit - a single bit - into the cell and strike it from the
+   * candidates of the cell's peers. Every change goes onto the trail so that
+   * undo() can roll it back. Returns false if the digit is not a candidate of
+   * the cell or if one of the peers is left without candidates.
+   */
+  bool place_digit(size_t cell, CandidateMask digit)
+  {
+    auto& cell_candidates = candidates_at(cell);
+    if(not (cell_candidates & digit))
+    {
+      return false;
+    }
+
+    trail_.push_back({static_cast<CellIndex>(cell), true, cell_candidates});
+    value_at(cell) = mask_to_digit(digit);
+    cell_candidates = 0;
+
+    row_digits_[Shape::ROW_OF[cell]] |= digit;
+    col_digits_[Shape::COL_OF[cell]] |= digit;
+    box_digits_[Shape::BOX_OF[cell]] |= digit;
+
+    for(auto peer : Shape::PEERS[cell])
+    {
+      if(not eliminate(peer, digit))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Remove the candidates in mask from the cell. Returns false if the cell is
+   * left without candidates.
+   */
+  bool eliminate(size_t cell, CandidateMask mask)
+  {
+    auto& cell_candidates = candidates_at(cell);
+    if(not (cell_candidates & mask))
+    {
+      return true;
+    }
+
+    trail_.push_back({static_cast<CellIndex>(cell), false, cell_candidates});
+    cell_candidates = static_cast<CandidateMask>(cell_candidates & ~mask);
+    return cell_candidates != 0;
+  }
+
+  /**
+   * Roll the trail back until it holds mark entries.
+   */
+  void undo(size_t mark)
+  {
+    while(trail_.size() > mark)
+    {
+      auto entry = trail_.back();
+      trail_.pop_back();
+
+      size_t cell = entry.cell;
+      if(entry.placed)
+      {
+        auto mask = static_cast<CandidateMask>(~digit_to_mask<CandidateMask>(value_at(cell)));
+        row_digits_[Shape::ROW_OF[cell]] &= mask;
+        col_digits_[Shape::COL_OF[cell]] &= mask;
+        box_digits_[Shape::BOX_OF[cell]] &= mask;
+        value_at(cell) = EMPTY_CELL;
+      }
+      candidates_at(cell) = entry.candidates;
+    }
+  }
+
+  /**
+   * Digits placed in the unit. The first SIZE units are the rows, then come
+   * the columns and then the boxes, as in Shape::UNITS.
+   */
+  CandidateMask unit_digits(size_t unit)
+  {
+    if(unit < SIZE)
+    {
+      return row_digits_[unit];
+    }
+    else if(unit < 2 * SIZE)
+    {
+      return col_digits_[unit - SIZE];
+    }
+
+    return box_digits_[unit - 2 * SIZE];
+  }
+
+  /**
+   * Fill every empty cell that is down to a single candidate.
+   */
+  bool place_naked_singles()
+  {
+    for(size_t x = 0; x < SIZE; ++x)
+    {
+      for(size_t y = 0; y < SIZE; ++y)
+      {
+        auto cell_candidates = candidates_at(x, y);
+        if(std::has_single_bit(cell_candidates) and not place_digit(x * SIZE + y, cell_candidates))
+        {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Fill every cell that is the only place left for a digit in one of its
+   * units. Fails if a unit has a digit that fits nowhere.
+   */
+  bool place_hidden_singles()
+  {
+    for(size_t unit = 0; unit < Shape::NUM_UNITS; ++unit)
+    {
+      CandidateMask once = 0, twice = 0;
+      for(auto cell : Shape::UNITS[unit])
+      {
+        auto cell_candidates = candidates_at(cell);
+        twice |= once & cell_candidates;
+        once |= cell_candidates;
+      }
+
+      if((once | unit_digits(unit)) != ALL_DIGITS)
+      {
+        return false;
+      }
+
+      auto singles = static_cast<CandidateMask>(once & ~twice);
+      for(size_t i = 0; i < SIZE and singles; ++i)
+      {
+        size_t cell = Shape::UNITS[unit][i];
+        auto single = static_cast<CandidateMask>(candidates_at(cell) & singles);
+        if(not single)
+        {
+          continue;
+        }
+
+        // two hidden singles in one cell can't both be placed
+        if(not std::has_single_bit(single) or not place_digit(cell, single))
+        {
+          return false;
+        }
+        singles &= static_cast<CandidateMask>(~single);
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Pointing: a digit confined to one row (column) of a box is removed from
+   * the rest of that row (column). Claiming: a digit confined to one box
+   * within a row (column) is removed from the rest of that box.
+   */
+  bool eliminate_locked_candidates()
+  {
+    // the candidates of every row and column within each box it crosses
+    std::array<std::array<CandidateMask, ORDER>, SIZE> row_segments{}, col_segments{};
+    for(size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto x = cell / SIZE, y = cell % SIZE;
+      row_segments[x][y / ORDER] |= candidates_at(cell);
+      col_segments[y][x / ORDER] |= candidates_at(cell);
+    }
+
+    // take the digits from the cells of the segment's box (claiming) and line (pointing) outside of it
+    auto strike = [&](size_t x, size_t y, CandidateMask claimed, CandidateMask pointing, bool columns) {
+      auto cell_at = [&](size_t i, size_t j) { return columns ? j * SIZE + i : i * SIZE + j; };
+      size_t line_offset = x - x % ORDER, segment_offset = y - y % ORDER;
+      for(size_t step = 0; step < SIZE; ++step)
+      {
+        size_t i = line_offset + step / ORDER, j = segment_offset + step % ORDER;
+        if(claimed and i != x and not eliminate(cell_at(i, j), claimed))
+        {
+          return false;
+        }
+
+        if(pointing and (step < segment_offset or step >= segment_offset + ORDER) and not eliminate(cell_at(x, step), pointing))
+        {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    for(size_t columns = 0; columns < 2; ++columns)
+    {
+      const auto& segments = columns ? col_segments : row_segments;
+      for(size_t line = 0; line < SIZE; ++line)
+      {
+        size_t line_offset = line - line % ORDER;
+        for(size_t k = 0; k < ORDER; ++k)
+        {
+          // the digits the segment has to itself within its line, and within its box
+          auto claimed = only_in(segments[line], k);
+          std::array<CandidateMask, ORDER> in_box{};
+          for(size_t i = 0; i < ORDER; ++i)
+          {
+            in_box[i] = segments[line_offset + i][k];
+          }
+          auto pointing = only_in(in_box, line % ORDER);
+
+          if((claimed or pointing) and not strike(line, k * ORDER, claimed, pointing, columns))
+          {
+            return false;
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Candidates of parts[i] that none of the other parts has.
+   */
+  static CandidateMask only_in(const std::array<CandidateMask, ORDER>& parts, size_t i)
+  {
+    CandidateMask others = 0;
+    for(size_t k = 0; k < ORDER; ++k)
+    {
+      others |= k != i ? parts[k] : CandidateMask{0};
+    }
+
+    return static_cast<CandidateMask>(parts[i] & ~others);
+  }
+
+  /**
+   * Call fn(items, union) for every choice of size of the masks, each with
+   * two to size bits, whose union has just size bits. Bit i of items stands
+   * for masks[i]. Stops and returns false as soon as fn does.
+   */
+  template <typename Fn>
+  static bool for_each_locked_set(const std::array<CandidateMask, SIZE>& masks, size_t size, Fn&& fn)
+  {
+    // only these masks can be part of a set
+    std::array<std::uint8_t, SIZE> items{};
+    size_t num_items = 0;
+    for(size_t i = 0; i < SIZE; ++i)
+    {
+      auto bits = static_cast<size_t>(std::popcount(masks[i]));
+      if(bits >= 2 and bits <= size)
+      {
+        items[num_items++] = static_cast<std::uint8_t>(i);
+      }
+    }
+
+    auto extend = [&](auto& self, size_t first, size_t chosen, CandidateMask set, CandidateMask cover) -> bool {
+      if(chosen == size)
+      {
+        return static_cast<size_t>(std::popcount(cover)) != size or fn(set, cover);
+      }
+
+      for(auto k = first; k + size - chosen <= num_items; ++k)
+      {
+        auto i = items[k];
+        auto joined = static_cast<CandidateMask>(cover | masks[i]);
+        if(static_cast<size_t>(std::popcount(joined)) <= size
+          and not self(self, k + 1, chosen + 1, static_cast<CandidateMask>(set | CandidateMask{1} << i), joined))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    };
+
+    return num_items < size or extend(extend, 0, 0, CandidateMask{0}, CandidateMask{0});
+  }
+
+  /**
+   * Naked subsets: size cells of a unit that hold only size candidates
+   * between them take those digits from the rest of the unit.
+   */
+  bool eliminate_naked_subsets(size_t size)
+  {
+    for(const auto& unit : Shape::UNITS)
+    {
+      std::array<CandidateMask, SIZE> masks{};
+      size_t num_empty = 0;
+      for(size_t i = 0; i < SIZE; ++i)
+      {
+        masks[i] = candidates_at(unit[i]);
+        num_empty += masks[i] != 0;
+      }
+
+      // a subset of all empty cells takes nothing from any cell
+      if(num_empty <= size)
+      {
+        continue;
+      }
+
+      bool consistent = for_each_locked_set(masks, size, [&](CandidateMask cells, CandidateMask digits) {
+        for(size_t i = 0; i < SIZE; ++i)
+        {
+          if(not (cells >> i & 1) and not eliminate(unit[i], digits))
+          {
+            return false;
+          }
+        }
+        return true;
+      });
+
+      if(not consistent)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * For every unit and digit the cells of the unit the digit fits in, bit i
+   * standing for Shape::UNITS[unit][i]: the columns of a row, the rows of a
+   * column.
+   */
+  DigitPlaces digit_places()
+  {
+    DigitPlaces places{};
+    for(size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      auto x = Shape::ROW_OF[cell], y = Shape::COL_OF[cell], box = Shape::BOX_OF[cell];
+      auto in_box = (x % ORDER) * ORDER + y % ORDER;
+      for(auto cell_candidates = candidates_at(cell); cell_candidates; cell_candidates &= cell_candidates - 1)
+      {
+        auto digit = static_cast<size_t>(std::countr_zero(cell_candidates));
+        places[x][digit] |= static_cast<CandidateMask>(CandidateMask{1} << y);
+        places[SIZE + y][digit] |= static_cast<CandidateMask>(CandidateMask{1} << x);
+        places[2 * SIZE + box][digit] |= static_cast<CandidateMask>(CandidateMask{1} << in_box);
+      }
+    }
+
+    return places;
+  }
+
+  /**
+   * Hidden subsets: size digits that fit in only size cells of a unit between
+   * them leave those cells no other candidates.
+   */
+  bool eliminate_hidden_subsets(size_t size, const DigitPlaces& places)
+  {
+    for(size_t unit = 0; unit < Shape::NUM_UNITS; ++unit)
+    {
+      CandidateMask empty = 0;
+      for(auto cells : places[unit])
+      {
+        empty |= cells;
+      }
+
+      if(static_cast<size_t>(std::popcount(empty)) <= size)
+      {
+        continue;
+      }
+
+      bool consistent = for_each_locked_set(places[unit], size, [&](CandidateMask digits, CandidateMask cells) {
+        for(; cells; cells &= cells - 1)
+        {
+          auto cell = Shape::UNITS[unit][static_cast<size_t>(std::countr_zero(cells))];
+          if(not eliminate(cell, static_cast<CandidateMask>(ALL_DIGITS & ~digits)))
+          {
+            return false;
+          }
+        }
+        return true;
+      });
+
+      if(not consistent)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Fish: if a digit fits in size rows only within the same size columns,
+   * those rows take every place for it in the columns, so it goes from the
+   * other rows of the columns; likewise with rows and columns swapped. Size 2
+   * is the X-wing, size 3 the swordfish.
+   */
+  bool eliminate_fish(size_t size, const DigitPlaces& places)
+  {
+    for(size_t digit = 0; digit < SIZE; ++digit)
+    {
+      auto mask = static_cast<CandidateMask>(CandidateMask{1} << digit);
+
+      // the lines the digit fits in, across the rows (lines = 0) and then the columns (lines = 1)
+      for(size_t lines = 0; lines < 2; ++lines)
+      {
+        std::array<CandidateMask, SIZE> line_places{}, cross_places{};
+        for(size_t i = 0; i < SIZE; ++i)
+        {
+          line_places[i] = places[lines * SIZE + i][digit];
+          cross_places[i] = places[(1 - lines) * SIZE + i][digit];
+        }
+
+        bool consistent = for_each_locked_set(line_places, size, [&](CandidateMask base, CandidateMask cover) {
+          for(; cover; cover &= cover - 1)
+          {
+            auto i = static_cast<size_t>(std::countr_zero(cover));
+            for(auto others = static_cast<CandidateMask>(cross_places[i] & ~base); others; others &= others - 1)
+            {
+              auto j = static_cast<size_t>(std::countr_zero(others));
+              if(not eliminate(lines ? i * SIZE + j : j * SIZE + i, mask))
+              {
+                return false;
+              }
+            }
+          }
+          return true;
+        });
+
+        if(not consistent)
+        {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * One pass of the technique over the grid. Returns false on a contradiction.
+   * The techniques that go by the places of the digits fill in places unless
+   * the caller kept them from a pass that changed nothing.
+   */
+  bool apply_technique(Technique technique, std::optional<DigitPlaces>& places)
+  {
+    auto known_places = [&]() -> const DigitPlaces& {
+      if(not places)
+      {
+        places = digit_places();
+      }
+      return *places;
+    };
+
+    switch(technique)
+    {
+      case Technique::HIDDEN_SINGLE:
+        return place_hidden_singles();
+      case Technique::NAKED_SINGLE:
+        return place_naked_singles();
+      case Technique::LOCKED_CANDIDATES:
+        return eliminate_locked_candidates();
+      case Technique::NAKED_PAIR:
+        return eliminate_naked_subsets(2);
+      case Technique::HIDDEN_PAIR:
+        return eliminate_hidden_subsets(2, known_places());
+      case Technique::NAKED_TRIPLE:
+        return eliminate_naked_subsets(3);
+      case Technique::HIDDEN_TRIPLE:
+        return eliminate_hidden_subsets(3, known_places());
+      case Technique::X_WING:
+        return eliminate_fish(2, known_places());
+      case Technique::SWORDFISH:
+        return eliminate_fish(3, known_places());
+      case Technique::NONE:
+      case Technique::SEARCH:
+        break;
+    }
+
+    return true;
+  }
+
+  /**
+   * Apply the deductions enabled by the propagation mode until none of them
+   * changes the grid any more. Returns false on a contradiction.
+   */
+  bool propagate()
+  {
+    if(propagation_ == Propagation::NONE)
+    {
+      return true;
+    }
+
+    for(auto last_size = trail_.size() + 1; last_size != trail_.size();)
+    {
+      last_size = trail_.size();
+      stats_.propagation_round();
+      if(not place_naked_singles() or not place_hidden_singles())
+      {
+        return false;
+      }
+
+      if(propagation_ == Propagation::LOCKED_CANDIDATES and not eliminate_locked_candidates())
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Number of empty cells among the peers of the cell.
+   */
+  size_t degree(size_t cell)
+  {
+    size_t count = 0;
+    for(auto peer : Shape::PEERS[cell])
+    {
+      count += value_at(peer) == EMPTY_CELL;
+    }
+
+    return count;
+  }
+
+  /**
+   * Pick the empty cell to branch on according to the branching mode.
+   * Returns nothing once the grid is full.
+   */
+  std::optional<size_t> select_cell()
+  {
+    std::optional<size_t> best{};
+    size_t best_count = SIZE + 1;
+    size_t best_degree = 0;
+
+    for(size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      if(value_at(cell) != EMPTY_CELL)
+      {
+        continue;
+      }
+
+      if(branching_ == Branching::ROW_ORDER)
+      {
+        return cell;
+      }
+
+      auto count = static_cast<size_t>(std::popcount(candidates_at(cell)));
+      if(count < best_count)
+      {
+        best = cell;
+        best_count = count;
+        // a forced cell can't be beaten, so there is nothing to break ties for
+        if(count <= 1)
+        {
+          return best;
+        }
+
+        if(branching_ == Branching::MRV_DEGREE)
+        {
+          best_degree = degree(cell);
+        }
+      }
+      else if(count == best_count and branching_ == Branching::MRV_DEGREE)
+      {
+        auto cell_degree = degree(cell);
+        if(cell_degree > best_degree)
+        {
+          best = cell;
+          best_degree = cell_degree;
+        }
+      }
+    }
+
+    return best;
+  }
+
+  void push_decision(size_t cell)
+  {
+    decisions_[depth_++] = {static_cast<CellIndex>(cell),
+      candidates_at(cell),
+      static_cast<std::uint16_t>(trail_.size())};
+    stats_.branch_point(depth_);
+  }
+
+  /**
+   * Limit possible choices based on the row, column and square constraints
+   * then apply back-tracking algorithm, propagating to a fixpoint before
+   * branching on the cell picked by select_cell().
+   */
+  bool search()
+  {
+    depth_ = 0;
+    if(not propagate())
+    {
+      return false;
+    }
+
+    auto cell = select_cell();
+    if(not cell)
+    {
+      return true;
+    }
+
+    push_decision(*cell);
+    return resume();
+  }
+
+  /**
+   * Run the search from the decisions on the stack until the grid is full or
+   * every guess has failed. After a solution the stack is left as it is, so
+   * calling resume() again moves on to the next guess.
+   */
+  bool resume()
+  {
+    while(depth_ > 0)
+    {
+      if(not meter_.spend())
+      {
+        return false;
+      }
+
+      auto& frame = decisions_[depth_ - 1];
+      undo(frame.mark);
+
+      // tried every valid digit and still no solution? dead path
+      if(not frame.remaining)
+      {
+        --depth_;
+        continue;
+      }
+
+      auto digit = static_cast<CandidateMask>(frame.remaining & ~(frame.remaining - 1));
+      frame.remaining &= static_cast<CandidateMask>(~digit);
+
+      stats_.guess();
+      if(not place_digit(frame.cell, digit) or not propagate())
+      {
+        stats_.backtrack();
+        continue;
+      }
+
+      auto cell = select_cell();
+      if(not cell)
+      {
+        return true;
+      }
+      push_decision(*cell);
+    }
+
+    return false;
+  }
+
+
+  GameState solve_within(BudgetMeter meter)
+  {
+    [[maybe_unused]] auto timer = stats_.time();
+    meter_ = std::move(meter);
+    auto state = get_game_state();
+    if(state != GameState::VALID)
+    {
+      return state;
+    }
+    else if(search())
+    {
+      return GameState::SOLVED;
+    }
+    else if(not meter_.exhausted())
+    {
+      return GameState::VIOLATION;
+    }
+
+    reset();
+    return GameState::TIMED_OUT;
+  }
+
+  std::optional<size_t> count_within(size_t limit, BudgetMeter meter)
+  {
+    [[maybe_unused]] auto timer = stats_.time();
+    reset();
+    meter_ = std::move(meter);
+    auto state = get_game_state();
+    if(limit == 0 or (state != GameState::SOLVED and state != GameState::VALID))
+    {
+      return 0;
+    }
+    else if(state == GameState::SOLVED)
+    {
+      return 1;
+    }
+
+    size_t count = 0;
+    for(bool found = search(); found; found = resume())
+    {
+      if(++count == limit)
+      {
+        return count;
+      }
+    }
+
+    if(meter_.exhausted())
+    {
+      reset();
+      return std::nullopt;
+    }
+
+    return count;
+  }
+
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  bool solve()
+  {
+    return solve_within(BudgetMeter{}) == GameState::SOLVED;
+  }
+
+  /**
+   * Solve the puzzle unless that takes more than the budget, counting every
+   * guess as a node. Returns SOLVED with the solution in the grid, the reason
+   * if the puzzle has no solution, or TIMED_OUT once the budget ran out, which
+   * leaves the solver as the puzzle was loaded so it can be tried again.
+   */
+  GameState solve(const Budget& budget)
+  {
+    return solve_within(BudgetMeter{budget});
+  }
+
+  /**
+   * Number of solutions of the puzzle, counting no further than limit. The
+   * count starts from the puzzle as it was loaded, whatever an earlier search
+   * left in the grid. When the limit is reached the grid holds the last
+   * solution found.
+   */
+  size_t count_solutions(size_t limit)
+  {
+    return *count_within(limit, BudgetMeter{});
+  }
+
+  /**
+   * Count like count_solutions() unless that takes more than the budget. A
+   * count the budget cuts short, by running out or by a stop request, gives
+   * nothing and leaves the solver as the puzzle was loaded.
+   */
+  std::optional<size_t> count_solutions(size_t limit, const Budget& budget)
+  {
+    return count_within(limit, BudgetMeter{budget});
+  }
+
+  /**
+   * True if the puzzle has exactly one solution. The search stops at the
+   * second one.
+   */
+  bool is_unique()
+  {
+    return count_solutions(2) == 1;
+  }
+
+  /**
+   * Propagate from the current grid and, unless that settles the puzzle, hand
+   * fn the grid for each candidate of the cell the search would branch on.
+   * Returns SOLVED if propagation filled the grid, VALID if it branched, and
+   * the reason otherwise. Lets a caller split the search into subproblems.
+   */
+  template <typename Fn>
+  GameState branch(Fn&& fn)
+  {
+    auto state = get_game_state();
+    if(state != GameState::VALID)
+    {
+      return state;
+    }
+
+    depth_ = 0;
+    if(not propagate())
+    {
+      return GameState::VIOLATION;
+    }
+
+    auto cell = select_cell();
+    if(not cell)
+    {
+      return GameState::SOLVED;
+    }
+
+    for(auto digit : available_digits(candidates_at(*cell)))
+    {
+      value_at(*cell) = digit;
+      fn(solution());
+    }
+    value_at(*cell) = EMPTY_CELL;
+
+    return GameState::VALID;
+  }
+
+  /**
+   * Rate how hard the puzzle is for a human by solving it with the techniques
+   * alone, always taking the easiest one that gets further. Leaves the solver
+   * as the puzzle was loaded.
+   */
+  Rating rate()
+  {
+    Rating rating{};
+    rating.state = get_game_state();
+
+    while(rating.state == GameState::VALID)
+    {
+      auto technique = Technique::HIDDEN_SINGLE;
+      std::optional<DigitPlaces> places{};
+      for(auto mark = trail_.size(); technique < Technique::SEARCH; technique = static_cast<Technique>(static_cast<int>(technique) + 1))
+      {
+        if(not apply_technique(technique, places))
+        {
+          rating.state = GameState::VIOLATION;
+          break;
+        }
+        else if(trail_.size() != mark)
+        {
+          break;
+        }
+      }
+
+      if(rating.state != GameState::VALID)
+      {
+        break;
+      }
+
+      rating.add_step(technique);
+      if(technique == Technique::SEARCH)
+      {
+        break;
+      }
+      else if(std::find(grid_.begin(), grid_.end(), EMPTY_CELL) == grid_.end())
+      {
+        rating.state = GameState::SOLVED;
+      }
+    }
+
+    reset();
+    return rating;
+  }
+
+  /**
+   * What the searches of this solver did so far.
+   */
+  const Stats& stats() const
+  {
+    return stats_;
+  }
+
+  /**
+   * Throws like BasicBoard on puzzles that aren't a line of cells. The trail
+   * is allocated from memory.
+   */
+  BasicSudokuSolver(std::string_view puzzle,
+    Branching branching = Branching::MRV,
+    Propagation propagation = Propagation::SINGLES,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+    : BasicSudokuSolver{BasicBoard<Order>{puzzle}, branching, propagation, memory}
+  {}
+
+  BasicSudokuSolver(std::string_view puzzle, std::pmr::memory_resource* memory)
+    : BasicSudokuSolver{BasicBoard<Order>{puzzle}, Branching::MRV, Propagation::SINGLES, memory}
+  {}
+
+  BasicSudokuSolver(const BasicBoard<Order>& board, std::pmr::memory_resource* memory)
+    : BasicSudokuSolver{board, Branching::MRV, Propagation::SINGLES, memory}
+  {}
+
+  explicit BasicSudokuSolver(const BasicBoard<Order>& board,
+    Branching branching = Branching::MRV,
+    Propagation propagation = Propagation::SINGLES,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+    : trail_{memory}, branching_{branching}, propagation_{propagation}
+  {
+    trail_.reserve(MAX_TRAIL_SIZE);
+    load(board);
+  }
+
+  /**
+   * Start over on another puzzle, keeping the buffers, the modes and the stop
+   * flag. Costs no allocation, so one solver can work through many puzzles.
+   */
+  void load(std::string_view puzzle)
+  {
+    load(BasicBoard<Order>{puzzle});
+  }
+
+  void load(const BasicBoard<Order>& board)
+  {
+    puzzle_ = board;
+    reset();
+  }
+
+  /**
+   * Go back to the puzzle as it was loaded, dropping the search state.
+   */
+  void reset()
+  {
+    grid_ = puzzle_.cells();
+    trail_.clear();
+    depth_ = 0;
+    update_constraints();
+  }
+
+  /**
+   * The puzzle as it was loaded.
+   */
+  const BasicBoard<Order>& puzzle() const
+  {
+    return puzzle_;
+  }
+
+  GameState get_game_state()
+  {
+    auto scan = scan_units<Order>(grid_);
+    if(scan.duplicate)
+    {
+      return GameState::VIOLATION;
+    }
+
+    size_t num_filled_cells = 0;
+    for(size_t row = 0; row < SIZE; ++row)
+    {
+      num_filled_cells += static_cast<size_t>(std::popcount(scan.digits[row]));
+    }
+
+    if(num_filled_cells == NUM_CELLS)
+    {
+      return GameState::SOLVED;
+    }
+
+    for(size_t cell = 0; cell < NUM_CELLS; ++cell)
+    {
+      if(value_at(cell) == EMPTY_CELL and not candidates_at(cell))
+      {
+        return GameState::NO_CHOICES_FOR_EMPTY_CELL;
+      }
+    }
+
+    return GameState::VALID;
+  }
+
+  inline char& get_value(std::size_t x, std::size_t y)
+  {
+    check_cell(x, y, grid_);
+    return value_at(x, y);
+  }
+
+  inline CandidateMask& get_candidates(std::size_t x, std::size_t y)
+  {
+    check_cell(x, y, candidates_);
+    return candidates_at(x, y);
+  }
+
+  /**
+   * Number of digits that can still go into the cell.
+   */
+  inline size_t get_constraint_count(std::size_t x, std::size_t y)
+  {
+    check_cell(x, y, candidates_);
+    return candidate_count(x, y);
+  }
+
+  inline void set_value(std::size_t x, std::size_t y, char value)
+  {
+    check_cell(x, y, grid_);
+    value_at(x, y) = value;
+  }
+
+  void print_grid(size_t hx=1000, size_t hy=1000)
+  {
+    static const std::string GREEN = "\033[32m";
+    static const std::string RESET = "\033[0m";
+
+    for(size_t x = 0; x < SIZE; ++x)
+    {
+      for(size_t y = 0; y < SIZE; ++y)
+      {
+        if(x == hx and y == hy)
+        {
+          fmt::print(" {}{}{}", GREEN, value_at(x, y), RESET);
+        }
+        else
+        {
+          fmt::print(" {}", value_at(x, y));
+        }
+      }
+      fmt::print("\n");
+    }
+  }
+
+
+  /**
+   * The grid as a string of NUM_CELLS digits, filled in once solve() succeeds.
+   */
+  std::string_view solution() const
+  {
+    return {grid_.data(), grid_.size()};
+  }
+
+  void print_solution()
+  {
+    fmt::print("{}\n", solution());
+  }
+
+  void print_constraint_counts(size_t hx=1000, size_t hy=1000)
+  {
+    static const std::string GREEN = "\033[32m";
+    static const std::string RESET = "\033[0m";
+
+    for(size_t x = 0; x < SIZE; ++x)
+    {
+      for(size_t y = 0; y < SIZE; ++y)
+      {
+        if(x == hx and y == hy)
+        {
+          fmt::print(" {}{}{}", GREEN, candidate_count(x, y), RESET);
+        }
+        else
+        {
+          fmt::print(" {}", candidate_count(x, y));
+        }
+      }
+      fmt::print("\n");
+    }
+  }
+};
+
+
+using SudokuSolver = BasicSudokuSolver<3>;
+
+/**
+ * BasicSudokuSolver that keeps SearchStats, for the front end's --stats.
+ */
+template <std::size_t Order>
+using InstrumentedSolver = BasicSudokuSolver<Order, SearchStats>;
@@ -0,0 +1,420 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "grid.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SUDOKU_HAS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+
+/**
+ * Instruction sets the grid scans can run on, best last.
+ */
+enum class SimdLevel
+{
+  SCALAR = 1, // plain loops, works everywhere
+  SSE41 = 2,  // 128 bit kernels
+  AVX2 = 3,   // 256 bit kernels
+};
+
+
+/**
+ * Best instruction set of the CPU the program runs on, detected once.
+ */
+inline SimdLevel simd_level()
+{
+#ifdef SUDOKU_HAS_X86_SIMD
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+      return SimdLevel::AVX2;
+    }
+    else if(__builtin_cpu_supports("sse4.1"))
+    {
+      return SimdLevel::SSE41;
+    }
+    return SimdLevel::SCALAR;
+  }();
+  return level;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+
+/**
+ * Digits placed in every unit of a grid, indexed like Geometry::UNITS, and
+ * whether some unit holds a digit twice.
+ */
+template <std::size_t Order>
+struct UnitScan
+{
+  std::array<typename Geometry<Order>::Mask, Geometry<Order>::NUM_UNITS> digits{};
+  bool duplicate{false};
+};
+
+
+template <std::size_t Order>
+UnitScan<Order> scan_units_scalar(const grid<char, Geometry<Order>::SIZE>& cells)
+{
+  using Shape = Geometry<Order>;
+  using Mask = typename Shape::Mask;
+
+  UnitScan<Order> scan{};
+  Mask repeated = 0;
+  for(std::size_t unit = 0; unit < Shape::NUM_UNITS; ++unit)
+  {
+    Mask once = 0, twice = 0;
+    for(auto cell : Shape::UNITS[unit])
+    {
+      char value = cells[cell];
+      auto digit = value == EMPTY_CELL ? Mask{0} : digit_to_mask<Mask>(value);
+      twice |= once & digit;
+      once |= digit;
+    }
+
+    scan.digits[unit] = once;
+    repeated |= twice;
+  }
+
+  scan.duplicate = repeated != 0;
+  return scan;
+}
+
+
+/**
+ * Candidates of every cell given the digits of its units: none for filled
+ * cells, the digits missing from the row, column and box for empty ones.
+ */
+template <std::size_t Order>
+void fill_candidates_scalar(const grid<char, Geometry<Order>::SIZE>& cells,
+  const UnitScan<Order>& scan,
+  grid<typename Geometry<Order>::Mask, Geometry<Order>::SIZE>& candidates)
+{
+  using Shape = Geometry<Order>;
+  using Mask = typename Shape::Mask;
+
+  for(std::size_t cell = 0; cell < Shape::NUM_CELLS; ++cell)
+  {
+    auto used = scan.digits[Shape::ROW_OF[cell]] | scan.digits[Shape::SIZE + Shape::COL_OF[cell]]
+                | scan.digits[2 * Shape::SIZE + Shape::BOX_OF[cell]];
+    candidates[cell] = cells[cell] == EMPTY_CELL ? static_cast<Mask>(~used & Shape::ALL_DIGITS) : Mask{0};
+  }
+}
+
+
+#ifdef SUDOKU_HAS_X86_SIMD
+
+/**
+ * The vector kernels handle 9x9 grids. They first rearrange the grid into a
+ * unit-major layout: entry i * LANES + u holds cell i of unit u, so all 27
+ * units are reduced side by side, one vector lane each, in 9 steps that only
+ * need vertical OR and AND. The rearranging is a byte shuffle of the grid held
+ * in SOURCES registers.
+ */
+struct UnitGather
+{
+  static constexpr std::size_t LANES = 32;                                  // the 27 units, padded
+  static constexpr std::size_t BLOCKS = Geometry<3>::SIZE * LANES / 16;    // 16 byte blocks of the layout
+  static constexpr std::size_t SOURCES = (Geometry<3>::NUM_CELLS + 15) / 16; // 16 byte blocks of the grid
+  static constexpr std::uint8_t ZERO = 0x80;                                // shuffle index that yields zero
+
+  using Shuffle = std::array<std::uint8_t, 16>;
+
+  // bytes of layout block k taken from grid block s, ZERO where they come from elsewhere
+  std::array<std::array<Shuffle, SOURCES>, BLOCKS> shuffles{};
+
+  static constexpr UnitGather make()
+  {
+    using Shape = Geometry<3>;
+
+    UnitGather gather{};
+    for(std::size_t block = 0; block < BLOCKS; ++block)
+    {
+      for(std::size_t source = 0; source < SOURCES; ++source)
+      {
+        for(std::size_t byte = 0; byte < 16; ++byte)
+        {
+          auto position = block * 16 + byte;
+          auto i = position / LANES, unit = position % LANES;
+          auto cell = unit < Shape::NUM_UNITS ? std::size_t{Shape::UNITS[unit][i]} : Shape::NUM_CELLS;
+
+          bool in_source = cell >= source * 16 and cell < source * 16 + 16;
+          gather.shuffles[block][source][byte] = in_source ? static_cast<std::uint8_t>(cell - source * 16) : ZERO;
+        }
+      }
+    }
+
+    return gather;
+  }
+};
+
+static constexpr UnitGather UNIT_GATHER = UnitGather::make();
+
+// byte halves of the digit mask for the values 0 (empty) to 9
+static constexpr std::array<std::uint8_t, 16> MASK_LOW_BYTES{0, 1, 2, 4, 8, 16, 32, 64, 128};
+static constexpr std::array<std::uint8_t, 16> MASK_HIGH_BYTES{0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+
+
+using PaddedCells = std::array<char, UnitGather::SOURCES * 16>;
+
+inline PaddedCells pad_cells(const grid<char, 9>& cells)
+{
+  PaddedCells padded{};
+  std::memcpy(padded.data(), cells.data(), cells.size());
+  return padded;
+}
+
+
+[[gnu::target("sse4.1"), gnu::always_inline]] inline __m128i load_bytes(const void* data)
+{
+  return _mm_loadu_si128(static_cast<const __m128i*>(data));
+}
+
+
+/**
+ * The digit values of the padded grid, 0 for empty cells. The padding turns
+ * negative, which the byte shuffles read as zero. Vector types lose their
+ * alignment attributes as template arguments, hence the plain array.
+ */
+struct DigitValues
+{
+  __m128i blocks[UnitGather::SOURCES];
+};
+
+[[gnu::target("sse4.1"), gnu::always_inline]] inline DigitValues load_digit_values(const PaddedCells& padded)
+{
+  DigitValues values{};
+  for(std::size_t source = 0; source < UnitGather::SOURCES; ++source)
+  {
+    values.blocks[source] = _mm_sub_epi8(load_bytes(padded.data() + source * 16), _mm_set1_epi8(EMPTY_CELL));
+  }
+  return values;
+}
+
+
+/**
+ * Block number block of the unit-major layout of the digit values.
+ */
+[[gnu::target("sse4.1"), gnu::always_inline]] inline __m128i gather_block(const DigitValues& values, std::size_t block)
+{
+  auto gathered = _mm_setzero_si128();
+  for(std::size_t source = 0; source < UnitGather::SOURCES; ++source)
+  {
+    auto shuffle = load_bytes(UNIT_GATHER.shuffles[block][source].data());
+    gathered = _mm_or_si128(gathered, _mm_shuffle_epi8(values.blocks[source], shuffle));
+  }
+  return gathered;
+}
+
+
+[[gnu::target("sse4.1")]] inline UnitScan<3> scan_units_sse41(const grid<char, 9>& cells)
+{
+  auto values = load_digit_values(pad_cells(cells));
+  auto low_bytes = load_bytes(MASK_LOW_BYTES.data());
+  auto high_bytes = load_bytes(MASK_HIGH_BYTES.data());
+
+  // four vectors of eight 16 bit lanes cover the padded units
+  __m128i once[4]{}, twice[4]{};
+  for(std::size_t block = 0; block < UnitGather::BLOCKS; ++block)
+  {
+    auto gathered = gather_block(values, block);
+    auto low = _mm_shuffle_epi8(low_bytes, gathered);
+    auto high = _mm_shuffle_epi8(high_bytes, gathered);
+
+    auto half = 2 * (block % 2);
+    __m128i digits[2]{_mm_unpacklo_epi8(low, high), _mm_unpackhi_epi8(low, high)};
+    for(std::size_t k = 0; k < 2; ++k)
+    {
+      twice[half + k] = _mm_or_si128(twice[half + k], _mm_and_si128(once[half + k], digits[k]));
+      once[half + k] = _mm_or_si128(once[half + k], digits[k]);
+    }
+  }
+
+  std::array<std::uint16_t, UnitGather::LANES> lanes{};
+  for(std::size_t k = 0; k < 4; ++k)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.data() + 8 * k), once[k]);
+  }
+
+  UnitScan<3> scan{};
+  std::memcpy(scan.digits.data(), lanes.data(), sizeof(scan.digits));
+  auto repeated = _mm_or_si128(_mm_or_si128(twice[0], twice[1]), _mm_or_si128(twice[2], twice[3]));
+  scan.duplicate = not _mm_testz_si128(repeated, repeated);
+  return scan;
+}
+
+
+[[gnu::target("avx2")]] inline UnitScan<3> scan_units_avx2(const grid<char, 9>& cells)
+{
+  auto values = load_digit_values(pad_cells(cells));
+  auto low_bytes = load_bytes(MASK_LOW_BYTES.data());
+  auto high_bytes = load_bytes(MASK_HIGH_BYTES.data());
+
+  // two vectors of sixteen 16 bit lanes cover the padded units
+  __m256i once[2]{}, twice[2]{};
+  for(std::size_t block = 0; block < UnitGather::BLOCKS; ++block)
+  {
+    auto gathered = gather_block(values, block);
+    auto low = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(low_bytes, gathered));
+    auto high = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(high_bytes, gathered));
+    auto digits = _mm256_or_si256(low, _mm256_slli_epi16(high, 8));
+
+    auto k = block % 2;
+    twice[k] = _mm256_or_si256(twice[k], _mm256_and_si256(once[k], digits));
+    once[k] = _mm256_or_si256(once[k], digits);
+  }
+
+  std::array<std::uint16_t, UnitGather::LANES> lanes{};
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data()), once[0]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data() + 16), once[1]);
+
+  UnitScan<3> scan{};
+  std::memcpy(scan.digits.data(), lanes.data(), sizeof(scan.digits));
+  auto repeated = _mm256_or_si256(twice[0], twice[1]);
+  scan.duplicate = not _mm256_testz_si256(repeated, repeated);
+  return scan;
+}
+
+
+/**
+ * Digits of the columns and of the boxes of each band, spread out so that
+ * lane y belongs to column y. With the row digits broadcast, OR-ing a row's
+ * vectors gives the digits used by each of its cells.
+ */
+struct UnitLanes
+{
+  alignas(32) std::array<std::uint16_t, 16> cols{};
+  alignas(32) std::array<std::array<std::uint16_t, 16>, 3> bands{};
+
+  explicit UnitLanes(const UnitScan<3>& scan)
+  {
+    for(std::size_t y = 0; y < 9; ++y)
+    {
+      cols[y] = scan.digits[9 + y];
+      for(std::size_t band = 0; band < bands.size(); ++band)
+      {
+        bands[band][y] = scan.digits[18 + 3 * band + y / 3];
+      }
+    }
+  }
+};
+
+
+[[gnu::target("sse4.1")]] inline void fill_candidates_sse41(const grid<char, 9>& cells,
+  const UnitScan<3>& scan,
+  grid<std::uint16_t, 9>& candidates)
+{
+  auto padded = pad_cells(cells);
+  UnitLanes units{scan};
+  auto empty_cell = _mm_set1_epi16(EMPTY_CELL);
+  auto all_digits = _mm_set1_epi16(static_cast<short>(Geometry<3>::ALL_DIGITS));
+
+  for(std::size_t x = 0; x < 9; ++x)
+  {
+    auto row = load_bytes(padded.data() + 9 * x);
+    auto row_digits = _mm_set1_epi16(static_cast<short>(scan.digits[x]));
+
+    std::array<std::uint16_t, 16> lanes{};
+    for(std::size_t half = 0; half < 2; ++half)
+    {
+      auto values = _mm_cvtepu8_epi16(half ? _mm_srli_si128(row, 8) : row);
+      auto empty = _mm_and_si128(_mm_cmpeq_epi16(values, empty_cell), all_digits);
+      auto used = _mm_or_si128(row_digits,
+        _mm_or_si128(load_bytes(units.cols.data() + 8 * half), load_bytes(units.bands[x / 3].data() + 8 * half)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes.data() + 8 * half), _mm_andnot_si128(used, empty));
+    }
+    std::memcpy(candidates.data() + 9 * x, lanes.data(), 9 * sizeof(std::uint16_t));
+  }
+}
+
+
+[[gnu::target("avx2")]] inline void fill_candidates_avx2(const grid<char, 9>& cells,
+  const UnitScan<3>& scan,
+  grid<std::uint16_t, 9>& candidates)
+{
+  auto padded = pad_cells(cells);
+  UnitLanes units{scan};
+  auto empty_cell = _mm256_set1_epi16(EMPTY_CELL);
+  auto all_digits = _mm256_set1_epi16(static_cast<short>(Geometry<3>::ALL_DIGITS));
+  auto cols = _mm256_load_si256(reinterpret_cast<const __m256i*>(units.cols.data()));
+
+  for(std::size_t x = 0; x < 9; ++x)
+  {
+    auto values = _mm256_cvtepu8_epi16(load_bytes(padded.data() + 9 * x));
+    auto empty = _mm256_and_si256(_mm256_cmpeq_epi16(values, empty_cell), all_digits);
+    auto band = _mm256_load_si256(reinterpret_cast<const __m256i*>(units.bands[x / 3].data()));
+    auto used = _mm256_or_si256(_mm256_set1_epi16(static_cast<short>(scan.digits[x])), _mm256_or_si256(cols, band));
+
+    std::array<std::uint16_t, 16> lanes{};
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data()), _mm256_andnot_si256(used, empty));
+    std::memcpy(candidates.data() + 9 * x, lanes.data(), 9 * sizeof(std::uint16_t));
+  }
+}
+
+#endif
+
+
+/**
+ * Digits of every row, column and box in one pass over the grid, on the best
+ * kernel the level allows. Only 9x9 grids have vector kernels.
+ */
+template <std::size_t Order>
+UnitScan<Order> scan_units(const grid<char, Geometry<Order>::SIZE>& cells, SimdLevel level = simd_level())
+{
+#ifdef SUDOKU_HAS_X86_SIMD
+  if constexpr(Order == 3)
+  {
+    if(level == SimdLevel::AVX2)
+    {
+      return scan_units_avx2(cells);
+    }
+    else if(level == SimdLevel::SSE41)
+    {
+      return scan_units_sse41(cells);
+    }
+  }
+#endif
+
+  static_cast<void>(level);
+  return scan_units_scalar<Order>(cells);
+}
+
+
+/**
+ * Digits of every unit plus the candidates of every cell.
+ */
+template <std::size_t Order>
+UnitScan<Order> scan_grid(const grid<char, Geometry<Order>::SIZE>& cells,
+  grid<typename Geometry<Order>::Mask, Geometry<Order>::SIZE>& candidates,
+  SimdLevel level = simd_level())
+{
+  auto scan = scan_units<Order>(cells, level);
+
+#ifdef SUDOKU_HAS_X86_SIMD
+  if constexpr(Order == 3)
+  {
+    if(level == SimdLevel::AVX2)
+    {
+      fill_candidates_avx2(cells, scan, candidates);
+      return scan;
+    }
+    else if(level == SimdLevel::SSE41)
+    {
+      fill_candidates_sse41(cells, scan, candidates);
+      return scan;
+    }
+  }
+#endif
+
+  fill_candidates_scalar<Order>(cells, scan, candidates);
+  return scan;
+}
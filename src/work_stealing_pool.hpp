@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Runs tasks that may spawn further tasks on a fixed set of workers. Every
+ * worker owns a deque: it pushes and pops at the back, so it keeps working on
+ * the subtree it just split, while idle workers steal from the front, where
+ * the oldest and usually biggest tasks are.
+ */
+template <typename Task>
+class WorkStealingPool
+{
+private: /** ============================= TYPES ============================= **/
+  struct Queue
+  {
+    std::mutex mutex{};
+    std::deque<Task> tasks{};
+  };
+
+private: /** ============================= MEMBER VARS ============================= **/
+  std::vector<Queue> queues_;
+  // tasks pushed but not finished yet, queued or running
+  std::atomic<std::size_t> pending_{0};
+  std::atomic<bool> aborted_{false};
+
+private: /** ============================= MEMBER METHODS ============================= **/
+  std::optional<Task> take(std::size_t worker)
+  {
+    {
+      auto& own = queues_[worker];
+      std::lock_guard lock{own.mutex};
+      if(not own.tasks.empty())
+      {
+        auto task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return task;
+      }
+    }
+
+    for(std::size_t k = 1; k < queues_.size(); ++k)
+    {
+      auto& victim = queues_[(worker + k) % queues_.size()];
+      std::lock_guard lock{victim.mutex};
+      if(not victim.tasks.empty())
+      {
+        auto task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return task;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  explicit WorkStealingPool(std::size_t num_workers)
+    : queues_(std::max<std::size_t>(num_workers, 1))
+  {}
+
+  std::size_t num_workers() const
+  {
+    return queues_.size();
+  }
+
+  /**
+   * Tasks queued or running right now.
+   */
+  std::size_t pending() const
+  {
+    return pending_.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Queue the task on the worker's deque. Tasks may push from inside fn.
+   */
+  void push(std::size_t worker, Task task)
+  {
+    ++pending_;
+    auto& queue = queues_[worker];
+    std::lock_guard lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+  }
+
+  /**
+   * Call fn(worker, task) for every task until none are left. The calling
+   * thread is worker 0. An exception thrown by fn stops all workers and is
+   * rethrown here once they have stopped.
+   */
+  template <typename Fn>
+  void run(Fn&& fn)
+  {
+    std::exception_ptr error{};
+    std::mutex error_mutex{};
+
+    auto worker = [&](std::size_t id) {
+      try
+      {
+        while(pending_ > 0 and not aborted_)
+        {
+          auto task = take(id);
+          if(not task)
+          {
+            std::this_thread::yield();
+            continue;
+          }
+
+          fn(id, std::move(*task));
+          --pending_;
+        }
+      }
+      catch(...)
+      {
+        aborted_ = true;
+        std::lock_guard lock{error_mutex};
+        if(not error)
+        {
+          error = std::current_exception();
+        }
+      }
+    };
+
+    std::vector<std::thread> pool{};
+    pool.reserve(queues_.size() - 1);
+    for(std::size_t id = 1; id < queues_.size(); ++id)
+    {
+      pool.emplace_back(worker, id);
+    }
+
+    worker(0);
+    for(auto& thread : pool)
+    {
+      thread.join();
+    }
+
+    if(error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+};
@@ -12,3 +12,91 @@ TEST_CASE("Factorials are computed with constexpr", "[factorial]")
   STATIC_REQUIRE(Factorial(3) == 6);
   STATIC_REQUIRE(Factorial(10) == 3628800);
 }
+
+
+#include "grid.hpp"
+
+constexpr std::size_t digit_sum(std::uint16_t mask)
+{
+  std::size_t sum = 0;
+  for(auto digit : available_digits(mask))
+  {
+    sum = sum * 10 + static_cast<std::size_t>(digit - '0');
+  }
+  return sum;
+}
+
+TEST_CASE("Candidate digits are walked lowest first", "[grid]")
+{
+  STATIC_REQUIRE(digit_sum(0) == 0);
+  STATIC_REQUIRE(digit_sum(0b000000001) == 1);
+  STATIC_REQUIRE(digit_sum(0b100010110) == 2359);
+  STATIC_REQUIRE(digit_sum(Geometry<3>::ALL_DIGITS) == 123456789);
+}
+
+
+template <std::size_t Order>
+constexpr bool peers_are_consistent()
+{
+  using Shape = Geometry<Order>;
+  for(std::size_t cell = 0; cell < Shape::NUM_CELLS; ++cell)
+  {
+    const auto& peers = Shape::PEERS[cell];
+    for(std::size_t i = 0; i < peers.size(); ++i)
+    {
+      std::size_t peer = peers[i];
+      bool shares_unit = Shape::ROW_OF[peer] == Shape::ROW_OF[cell] or Shape::COL_OF[peer] == Shape::COL_OF[cell]
+                         or Shape::BOX_OF[peer] == Shape::BOX_OF[cell];
+      // sorted without repeats and never the cell itself
+      if(peer == cell or not shares_unit or (i > 0 and peers[i - 1] >= peer))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <std::size_t Order>
+constexpr bool units_cover_every_cell()
+{
+  using Shape = Geometry<Order>;
+  std::array<std::size_t, Shape::NUM_CELLS> seen{};
+  for(const auto& unit : Shape::UNITS)
+  {
+    for(auto cell : unit)
+    {
+      ++seen[cell];
+    }
+  }
+  for(auto count : seen)
+  {
+    if(count != 3)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Peer and unit tables are built at compile time", "[grid]")
+{
+  STATIC_REQUIRE(Geometry<2>::NUM_PEERS == 7);
+  STATIC_REQUIRE(Geometry<3>::NUM_PEERS == 20);
+  STATIC_REQUIRE(Geometry<5>::NUM_PEERS == 64);
+
+  STATIC_REQUIRE(Geometry<3>::ROW_OF[80] == 8);
+  STATIC_REQUIRE(Geometry<3>::COL_OF[12] == 3);
+  STATIC_REQUIRE(Geometry<3>::BOX_OF[0] == 0);
+  STATIC_REQUIRE(Geometry<3>::BOX_OF[40] == 4);
+  STATIC_REQUIRE(Geometry<3>::BOX_OF[80] == 8);
+  STATIC_REQUIRE(Geometry<3>::UNITS[9][8] == 72);
+  STATIC_REQUIRE(Geometry<3>::UNITS[26][0] == 60);
+  STATIC_REQUIRE(Geometry<3>::PEERS[0][19] == 72);
+
+  STATIC_REQUIRE(peers_are_consistent<2>());
+  STATIC_REQUIRE(peers_are_consistent<3>());
+  STATIC_REQUIRE(peers_are_consistent<4>());
+  STATIC_REQUIRE(units_cover_every_cell<3>());
+  STATIC_REQUIRE(units_cover_every_cell<5>());
+}
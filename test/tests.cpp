@@ -12,3 +12,1224 @@ TEST_CASE("Factorials are computed", "[factorial]")
   REQUIRE(Factorial(3) == 6);
   REQUIRE(Factorial(10) == 3628800);
 }
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <string>
+#include <stdexcept>
+#include <system_error>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "arena.hpp"
+#include "batch.hpp"
+#include "bounded_queue.hpp"
+#include "canonical_form.hpp"
+#include "puzzle_reader.hpp"
+#include "generator.hpp"
+#include "lru_cache.hpp"
+#include "packed_format.hpp"
+#include "solver.hpp"
+#include "stream_pipeline.hpp"
+#include "sudoku.h"
+#include "unit_scan.hpp"
+
+static constexpr std::string_view PUZZLE =
+  "003020600900305001001806400008102900700000008006708200002609500800203009005010300";
+static constexpr std::string_view SOLUTION =
+  "483921657967345821251876493548132976729564138136798245372689514814253769695417382";
+
+TEST_CASE("Backtracking solver finds the solution", "[solver]")
+{
+  for(auto branching : {Branching::ROW_ORDER, Branching::MRV, Branching::MRV_DEGREE})
+  {
+    for(auto propagation : {Propagation::NONE, Propagation::SINGLES, Propagation::LOCKED_CANDIDATES})
+    {
+      auto solver = SudokuSolver{PUZZLE, branching, propagation};
+      REQUIRE(solver.solve());
+      REQUIRE(solver.solution() == SOLUTION);
+    }
+  }
+}
+
+TEST_CASE("DLX solver finds the solution", "[dlx]")
+{
+  auto solver = DlxSolver{PUZZLE};
+  REQUIRE(solver.solve());
+  REQUIRE(solver.solution() == SOLUTION);
+}
+
+TEST_CASE("DLX solver counts solutions", "[dlx]")
+{
+  REQUIRE(DlxSolver{PUZZLE}.count_solutions(2) == 1);
+  REQUIRE(DlxSolver{std::string(81, '0')}.count_solutions(5) == 5);
+  REQUIRE(DlxSolver{"11"}.count_solutions(1) == 0);
+}
+
+TEST_CASE("Solvers reject contradicting clues", "[solver][dlx]")
+{
+  auto puzzle = std::string{"11"} + std::string(79, '0');
+  REQUIRE_FALSE(SudokuSolver{puzzle}.solve());
+  REQUIRE_FALSE(DlxSolver{puzzle}.solve());
+}
+
+TEST_CASE("Batch solving keeps the input order", "[batch]")
+{
+  auto unsolvable = std::string{"11"} + std::string(79, '0');
+  std::vector<std::string> puzzles{};
+  for(size_t i = 0; i < 3 * BATCH_CHUNK_SIZE + 7; ++i)
+  {
+    puzzles.push_back(i % 3 == 0 ? unsolvable : std::string{PUZZLE});
+  }
+
+  std::vector<std::string> chunks{};
+  solve_batch<BasicSudokuSolver>(std::span<const std::string>{puzzles}, 3, chunks);
+  REQUIRE(chunks.size() == 4);
+
+  std::string expected{}, output{};
+  for(size_t i = 0; i < puzzles.size(); ++i)
+  {
+    expected += i % 3 == 0 ? std::string{NO_SOLUTION} : std::string{SOLUTION};
+    expected += '\n';
+  }
+  for(auto& chunk : chunks)
+  {
+    output += chunk;
+  }
+  REQUIRE(output == expected);
+}
+
+TEST_CASE("Record reader splits lines without copying", "[reader]")
+{
+  std::string_view data = "123\r\n\n456\n\r\n789";
+  RecordReader reader{data};
+
+  std::vector<std::string_view> records{};
+  for(std::string_view record; reader.next(record);)
+  {
+    REQUIRE(record.data() >= data.data());
+    REQUIRE(record.data() < data.data() + data.size());
+    records.push_back(record);
+  }
+  REQUIRE(records == std::vector<std::string_view>{"123", "456", "789"});
+}
+
+TEST_CASE("Dots mark empty cells", "[solver][dlx]")
+{
+  auto puzzle = std::string{PUZZLE};
+  std::replace(puzzle.begin(), puzzle.end(), EMPTY_CELL, EMPTY_CELL_DOT);
+
+  auto solver = SudokuSolver{puzzle};
+  REQUIRE(solver.solve());
+  REQUIRE(solver.solution() == SOLUTION);
+
+  auto dlx = DlxSolver{puzzle};
+  REQUIRE(dlx.solve());
+  REQUIRE(dlx.solution() == SOLUTION);
+}
+
+TEST_CASE("Puzzles are checked at the public boundary", "[solver][dlx]")
+{
+  REQUIRE_THROWS_AS(SudokuSolver{std::string(82, '0')}, std::range_error);
+  REQUIRE_THROWS_AS(DlxSolver{std::string(82, '0')}, std::range_error);
+  REQUIRE_THROWS_AS(SudokuSolver{"12x"}, std::invalid_argument);
+  REQUIRE_THROWS_AS(DlxSolver{"12x"}, std::invalid_argument);
+
+  auto solver = SudokuSolver{PUZZLE};
+  REQUIRE(solver.get_value(0, 2) == '3');
+  REQUIRE_THROWS_AS(solver.get_value(9, 0), std::invalid_argument);
+  REQUIRE_THROWS_AS(solver.set_value(0, 9, '1'), std::invalid_argument);
+}
+
+/**
+ * Solve the puzzle with the solver for its box order and check that the result
+ * is a full grid that keeps every clue.
+ */
+template <std::size_t Order, template <std::size_t> class Engine>
+void require_solved(std::string_view puzzle)
+{
+  auto solver = Engine<Order>{puzzle};
+  REQUIRE(solver.solve());
+
+  auto solution = solver.solution();
+  REQUIRE(solution.size() == puzzle.size());
+  for(size_t i = 0; i < puzzle.size(); ++i)
+  {
+    REQUIRE((puzzle[i] == EMPTY_CELL or puzzle[i] == solution[i]));
+  }
+  REQUIRE(BasicSudokuSolver<Order>{solution}.get_game_state() == GameState::SOLVED);
+}
+
+TEST_CASE("Solvers handle every supported grid size", "[solver][dlx]")
+{
+  static constexpr std::string_view PUZZLE_4 = "0030102000400410";
+  static constexpr std::string_view PUZZLE_16 =
+  "00B020CAF003007000000070B90800020020F001D000800B05D6B0402AC031E0"
+  "284000F000D5060000E579B000001G0CF00100037600A80006090A00C0F00000"
+  "AB80GC02000E0D000000040B021000530F0E60008B000200000030006D000BA8"
+  "60509B8000000C31009BA2G000300E6004A01F0C0060B009000F500090000400";
+  static constexpr std::string_view PUZZLE_25 =
+  "010G0AH040080B0CF5ONJ0D0MM00I0E00L6291G730A005CONF0N00009G210000J00006A00K0"
+  "800B0500O04H00AI0J0P0G0100K000J0I0POF0C0G0700EB0080J00IHL0BEG271800F0AMN050"
+  "07010F4K3ABLE6H00M05000JDO0M00000G7I0JP96LHBE0K3044A0K30DPIJ0O000028G7H600L"
+  "00H0BM0NC03000F000I001072AC00F10000M00D007000K003E5000M07L800000140KH0NOF0A"
+  "0304H05DM00000N200906L8B700120KE0H000B00OANFC0DM000B6L000O0CHE300D50M0000G0"
+  "08L0103A000BH0050DNM00P0I002004B0000000L03O0FD00MC000E00C5NMK0F0O002P0L0180"
+  "30OAK20JP0NCM5D0G0184000BC005N000180000200400000F00D0M5010000P29006304CF00K"
+  "0O000000J25ND0I810703H006P000J36H047000BFK00O0050N600HE0005D0KOFC90GJ0B0001"
+  "00080CKFAO064000NI0DG002P";
+
+  STATIC_REQUIRE(order_for_cells(PUZZLE_4.size()) == 2);
+  STATIC_REQUIRE(order_for_cells(PUZZLE_16.size()) == 4);
+  STATIC_REQUIRE(order_for_cells(PUZZLE_25.size()) == 5);
+
+  require_solved<2, BasicSudokuSolver>(PUZZLE_4);
+  require_solved<2, BasicDlxSolver>(PUZZLE_4);
+  require_solved<3, BasicSudokuSolver>(PUZZLE);
+  require_solved<4, BasicSudokuSolver>(PUZZLE_16);
+  require_solved<4, BasicDlxSolver>(PUZZLE_16);
+  require_solved<5, BasicSudokuSolver>(PUZZLE_25);
+  require_solved<5, BasicDlxSolver>(PUZZLE_25);
+
+  REQUIRE_THROWS_AS(BasicSudokuSolver<4>{"H"}, std::invalid_argument);
+}
+
+
+TEST_CASE("Vector grid scans agree with the scalar scan", "[scan]")
+{
+  std::mt19937 rng{2024};
+  std::uniform_int_distribution<int> digit{0, 9};
+
+  std::vector<grid<char, 9>> grids{};
+  grid<char, 9> solved{};
+  std::copy(SOLUTION.begin(), SOLUTION.end(), solved.begin());
+  grids.push_back(solved);
+  for(int i = 0; i < 200; ++i)
+  {
+    // random cells, so most grids repeat digits somewhere
+    grid<char, 9> cells{};
+    std::generate(cells.begin(), cells.end(), [&]() { return static_cast<char>('0' + digit(rng)); });
+    grids.push_back(cells);
+
+    // solved grids with holes never repeat a digit
+    auto holes = solved;
+    std::generate(holes.begin(), holes.end(), [&, k = std::size_t{0}]() mutable {
+      auto value = solved[k++];
+      return digit(rng) < 4 ? EMPTY_CELL : value;
+    });
+    grids.push_back(holes);
+  }
+
+  for(auto level : {SimdLevel::SSE41, SimdLevel::AVX2})
+  {
+    if(level > simd_level())
+    {
+      continue;
+    }
+
+    for(const auto& cells : grids)
+    {
+      grid<std::uint16_t, 9> expected{}, candidates{};
+      auto reference = scan_units_scalar<3>(cells);
+      fill_candidates_scalar<3>(cells, reference, expected);
+      auto scan = scan_grid<3>(cells, candidates, level);
+
+      REQUIRE(scan.digits == reference.digits);
+      REQUIRE(scan.duplicate == reference.duplicate);
+      REQUIRE(candidates == expected);
+    }
+  }
+
+  REQUIRE(not scan_units<3>(solved).duplicate);
+}
+
+
+TEST_CASE("Lockstep propagation answers like the scalar search", "[batch]")
+{
+  std::vector<std::string> puzzles{
+    std::string{PUZZLE},
+    std::string{"11"} + std::string(79, '0'),
+    std::string(81, '0'),
+    "050100000000078395006000010900010600005062000620090000507000006400006000002050030",
+    "0030102000400410",
+    "007005489009006200003098007070000592000000600001000070045700000700000005000900010",
+    std::string{SOLUTION},
+    "600000000000700000000002004050000006060457802000900745000004000312070400085200900",
+    "00302060090030500100180640000810290070000000800670820000260950080020300900501030",
+  };
+  for(int copies = 0; copies < 3; ++copies)
+  {
+    puzzles.insert(puzzles.end(), puzzles.begin(), puzzles.begin() + 9);
+  }
+
+  std::string expected{};
+  for(const auto& puzzle : puzzles)
+  {
+    solve_into<BasicSudokuSolver>(puzzle, expected);
+  }
+
+  std::vector<std::string> chunks{};
+  solve_batch<BasicSudokuSolver>(std::span<const std::string>{puzzles}, 2, chunks);
+  std::string output{};
+  for(auto& chunk : chunks)
+  {
+    output += chunk;
+  }
+  REQUIRE(output == expected);
+
+#ifdef SUDOKU_HAS_LANES
+  LanePropagator lanes{};
+  lanes.load(0, PUZZLE);
+  lanes.load(1, puzzles[1]);
+  lanes.propagate();
+
+  auto cells = lanes.cells(0);
+  REQUIRE(lanes.solved(0));
+  REQUIRE(std::string_view{cells.data(), cells.size()} == SOLUTION);
+  REQUIRE(lanes.failed(1));
+  REQUIRE(lanes.failed(2));
+#endif
+}
+
+
+TEST_CASE("Parallel search splits one puzzle across threads", "[parallel]")
+{
+  auto empty_4 = std::string(16, '0');
+  REQUIRE(BasicSudokuSolver<2>{empty_4}.count_solutions(1000) == 288);
+  REQUIRE(BasicSudokuSolver<2>{empty_4}.count_solutions(10) == 10);
+  REQUIRE(ParallelSearch<2>{empty_4, 4}.count_solutions(1000) == 288);
+  REQUIRE(ParallelSearch<2>{empty_4, 4}.count_solutions(10) == 10);
+
+  // blanking the first rows of the puzzle leaves it with many solutions
+  auto loose = std::string(27, '0') + std::string{PUZZLE.substr(27)};
+  auto expected = DlxSolver{loose}.count_solutions(100000);
+  REQUIRE(expected > 1);
+  REQUIRE(SudokuSolver{loose}.count_solutions(100000) == expected);
+  REQUIRE(ParallelSearch<3>{loose, 3}.count_solutions(100000) == expected);
+
+  for(std::size_t threads : {1u, 2u, 4u})
+  {
+    ParallelSearch<3> search{PUZZLE, threads};
+    REQUIRE(search.solve());
+    REQUIRE(search.solution() == SOLUTION);
+    REQUIRE(ParallelSearch<3>{PUZZLE, threads}.count_solutions(2) == 1);
+    REQUIRE_FALSE(ParallelSearch<3>{std::string{"11"} + std::string(79, '0'), threads}.solve());
+  }
+
+  ParallelSearch<3> empty{std::string(81, '0'), 4};
+  REQUIRE(empty.solve());
+  require_solved<3, BasicSudokuSolver>(empty.solution());
+
+  // with many solutions the workers race to settle the search; whichever wins must hold a full grid
+  for(int run = 0; run < 200; ++run)
+  {
+    ParallelSearch<3> search{loose, 4};
+    REQUIRE(search.solve());
+    REQUIRE(SudokuSolver{search.solution()}.get_game_state() == GameState::SOLVED);
+  }
+}
+
+
+TEST_CASE("Uniqueness checks stop at the second solution", "[solver][dlx][batch]")
+{
+  auto loose = std::string(27, '0') + std::string{PUZZLE.substr(27)};
+  auto unsolvable = std::string{"11"} + std::string(79, '0');
+
+  REQUIRE(SudokuSolver{PUZZLE}.is_unique());
+  REQUIRE(DlxSolver{PUZZLE}.is_unique());
+  REQUIRE(ParallelSearch<3>{PUZZLE, 2}.is_unique());
+  REQUIRE_FALSE(SudokuSolver{loose}.is_unique());
+  REQUIRE_FALSE(DlxSolver{loose}.is_unique());
+  REQUIRE_FALSE(ParallelSearch<3>{loose, 2}.is_unique());
+  REQUIRE_FALSE(SudokuSolver{unsolvable}.is_unique());
+  REQUIRE(SudokuSolver{SOLUTION}.count_solutions(5) == 1);
+  REQUIRE(SudokuSolver{std::string(81, '0')}.count_solutions(3) == 3);
+
+  // the answer is the puzzle's, not that of whatever the last search left behind
+  auto repeated = [](auto solver) {
+    REQUIRE_FALSE(solver.is_unique());
+    REQUIRE_FALSE(solver.is_unique());
+    REQUIRE(solver.count_solutions(3) == 3);
+    REQUIRE(solver.solve());
+    REQUIRE_FALSE(solver.is_unique());
+  };
+  repeated(SudokuSolver{loose});
+  repeated(DlxSolver{loose});
+
+  std::vector<std::string> puzzles{std::string{PUZZLE}, loose, unsolvable, std::string{SOLUTION}, "0030102000400410"};
+  for(auto engine : {Backend::BACKTRACK, Backend::DLX})
+  {
+    std::vector<std::string> chunks{};
+    auto batch = std::span<const std::string>{puzzles};
+    if(engine == Backend::BACKTRACK)
+    {
+      solve_batch<BasicSudokuSolver>(batch, 2, chunks, 2);
+    }
+    else
+    {
+      solve_batch<BasicDlxSolver>(batch, 2, chunks, 2);
+    }
+    REQUIRE(chunks.size() == 1);
+    REQUIRE(chunks[0] == "1\n2\n0\n1\n2\n");
+  }
+}
+
+
+TEST_CASE("Generated puzzles have unique solutions", "[generator]")
+{
+  auto clues = [](std::string_view puzzle) { return puzzle.size() - static_cast<std::size_t>(std::count(puzzle.begin(), puzzle.end(), '0')); };
+
+  for(auto difficulty : {Difficulty::EASY, Difficulty::MEDIUM, Difficulty::HARD})
+  {
+    auto puzzle = Generator{42}.generate(difficulty);
+    REQUIRE(puzzle.size() == 81);
+    REQUIRE(SudokuSolver{puzzle}.is_unique());
+    REQUIRE(puzzle == Generator{42}.generate(difficulty));
+    if(difficulty == Difficulty::EASY)
+    {
+      REQUIRE(clues(puzzle) >= 36);
+    }
+    else if(difficulty == Difficulty::MEDIUM)
+    {
+      REQUIRE(clues(puzzle) >= 30);
+    }
+  }
+
+  // every clue of a hard puzzle is needed
+  auto minimal = Generator{7}.generate(Difficulty::HARD);
+  for(std::size_t cell = 0; cell < minimal.size(); ++cell)
+  {
+    if(minimal[cell] != '0')
+    {
+      auto loose = minimal;
+      loose[cell] = '0';
+      REQUIRE_FALSE(SudokuSolver{loose}.is_unique());
+    }
+  }
+
+  auto small = BasicGenerator<2>{1}.generate(Difficulty::HARD);
+  REQUIRE(BasicSudokuSolver<2>{small}.is_unique());
+
+  // the puzzles don't depend on the number of threads
+  std::vector<std::string> one{}, three{};
+  generate_batch<3>(0, 300, Difficulty::MEDIUM, 5, 1, one);
+  generate_batch<3>(0, 300, Difficulty::MEDIUM, 5, 3, three);
+  REQUIRE(one == three);
+  REQUIRE(one.size() == 2);
+  REQUIRE(one[0].substr(0, 82) == Generator{5}.generate(Difficulty::MEDIUM) + "\n");
+}
+
+
+TEST_CASE("Search stats count the steps of the search", "[solver][stats]")
+{
+  STATIC_REQUIRE(sizeof(BasicSudokuSolver<3>) == sizeof(BasicSudokuSolver<3, NoStats>));
+
+  // propagation alone doesn't get far on this one, so the search branches and backs out of wrong guesses
+  static constexpr std::string_view HARD =
+    "100007090030020008009600500005300900010080002600004000300000010040000007007000300";
+  InstrumentedSolver<3> solver{HARD};
+  REQUIRE(solver.solve());
+  require_solved<3, BasicSudokuSolver>(solver.solution());
+
+  const auto& stats = solver.stats();
+  REQUIRE(stats.nodes > 0);
+  REQUIRE(stats.guesses > 0);
+  REQUIRE(stats.backtracks > 0);
+  REQUIRE(stats.max_depth > 0);
+  REQUIRE(stats.propagations > 0);
+  REQUIRE(stats.guesses >= stats.nodes);
+  REQUIRE(stats.guesses - stats.backtracks <= stats.nodes);
+  REQUIRE(stats.max_depth <= stats.nodes);
+  REQUIRE(stats.time_spent.count() > 0);
+
+  // propagation alone solves an easy puzzle
+  InstrumentedSolver<3> easy{PUZZLE};
+  REQUIRE(easy.solve());
+  REQUIRE(easy.solution() == SOLUTION);
+  REQUIRE(easy.stats().propagations > 0);
+  REQUIRE(easy.stats().nodes == 0);
+  REQUIRE(easy.stats().guesses == 0);
+  REQUIRE(easy.stats().backtracks == 0);
+  REQUIRE(easy.stats().max_depth == 0);
+
+  std::vector<std::string> puzzles{std::string{HARD}, std::string{SOLUTION}, "0030102000400410"};
+  std::vector<std::string> chunks{}, plain{};
+  std::vector<SearchStats> batch_stats{};
+  solve_batch_stats(std::span<const std::string>{puzzles}, 2, chunks, std::nullopt, batch_stats);
+  solve_batch<BasicSudokuSolver>(std::span<const std::string>{puzzles}, 2, plain);
+  REQUIRE(chunks == plain);
+  REQUIRE(batch_stats.size() == 3);
+  REQUIRE(batch_stats[0].nodes == stats.nodes);
+  REQUIRE(batch_stats[1].propagations == 0);
+
+  StatsSummary summary{};
+  for(const auto& puzzle : batch_stats)
+  {
+    summary.add(puzzle);
+  }
+  REQUIRE(summary.puzzles() == 3);
+  REQUIRE(summary.total().guesses == batch_stats[0].guesses + batch_stats[2].guesses);
+  REQUIRE(summary.nodes()[0] == static_cast<std::size_t>(std::count_if(batch_stats.begin(), batch_stats.end(), [](const auto& puzzle) { return puzzle.nodes == 0; })));
+  REQUIRE(std::accumulate(summary.nodes().begin(), summary.nodes().end(), std::size_t{0}) == 3);
+  REQUIRE(StatsSummary::bucket_floor(4) == 8);
+}
+
+
+TEST_CASE("Bounded queues hand every entry to exactly one consumer", "[stream]")
+{
+  BoundedQueue<std::size_t> queue{5};
+  REQUIRE(queue.capacity() == 8);
+
+  constexpr std::size_t PER_PRODUCER = 10000;
+  // Catch assertions aren't thread safe, so the threads only count
+  std::atomic<std::size_t> sum{0}, popped{0}, rejected{0};
+  std::vector<std::thread> producers{}, consumers{};
+  for(std::size_t p = 0; p < 3; ++p)
+  {
+    producers.emplace_back([&, p]() {
+      for(std::size_t i = 1; i <= PER_PRODUCER; ++i)
+      {
+        rejected += not queue.push(p * PER_PRODUCER + i);
+      }
+    });
+    consumers.emplace_back([&]() {
+      for(std::size_t value = 0; queue.pop(value);)
+      {
+        sum += value;
+        ++popped;
+      }
+    });
+  }
+
+  for(auto& thread : producers)
+  {
+    thread.join();
+  }
+  queue.close();
+  for(auto& thread : consumers)
+  {
+    thread.join();
+  }
+
+  constexpr std::size_t N = 3 * PER_PRODUCER;
+  REQUIRE(rejected == 0);
+  REQUIRE(popped == N);
+  REQUIRE(sum == N * (N + 1) / 2);
+
+  std::size_t value = 0;
+  REQUIRE_FALSE(queue.push(1));
+  REQUIRE_FALSE(queue.pop(value));
+}
+
+
+#ifdef SUDOKU_HAS_MMAP
+TEST_CASE("Streaming mode answers puzzles from a pipe in input order", "[stream]")
+{
+  std::string input{};
+  for(std::size_t i = 0; i < 1000; ++i)
+  {
+    input += i % 3 ? std::string{PUZZLE} : std::string(81, '0');
+    input += i % 2 ? "\n" : "\r\n";
+  }
+  input += "0030102000400410";
+
+  std::vector<std::string> chunks{};
+  std::vector<std::string_view> puzzles{};
+  RecordReader records{input};
+  for(std::string_view puzzle; records.next(puzzle);)
+  {
+    puzzles.push_back(puzzle);
+  }
+  solve_batch<BasicSudokuSolver>(std::span<const std::string_view>{puzzles}, 1, chunks, 2);
+  std::string expected{};
+  for(const auto& chunk : chunks)
+  {
+    expected += chunk;
+  }
+
+  int fds[2];
+  REQUIRE(::pipe(fds) == 0);
+  // dribble the input in small writes that split lines
+  bool written = true;
+  std::thread writer{[&]() {
+    for(std::size_t pos = 0; pos < input.size(); pos += 1000)
+    {
+      auto size = std::min<std::size_t>(1000, input.size() - pos);
+      written = written and ::write(fds[1], input.data() + pos, size) == static_cast<ssize_t>(size);
+    }
+    ::close(fds[1]);
+  }};
+
+  auto path = (std::filesystem::temp_directory_path() / "sudoku_stream_test.txt").string();
+  {
+    StreamReader reader{fds[0]};
+    OutputWriter output{path};
+    solve_stream<BasicSudokuSolver>(reader, 3, 2, output);
+  }
+  writer.join();
+  ::close(fds[0]);
+  REQUIRE(written);
+
+  MappedFile answers{path};
+  REQUIRE(answers.view() == expected);
+  std::filesystem::remove(path);
+}
+
+
+static std::atomic<bool> gate_open{false};
+static std::atomic<std::size_t> gated_solves{0};
+
+/**
+ * The backtracking engine, but a full grid is only solved once the gate is
+ * open. Counts the puzzles it has solved.
+ */
+template <std::size_t Order>
+class GatedSolver : public BasicSudokuSolver<Order>
+{
+private: /** ============================= MEMBER VARS ============================= **/
+  bool gated_{false};
+
+public: /** ============================= MEMBER METHODS ============================= **/
+  using BasicSudokuSolver<Order>::BasicSudokuSolver;
+  using BasicSudokuSolver<Order>::solve;
+
+  GatedSolver(std::string_view puzzle, std::pmr::memory_resource* memory)
+    : BasicSudokuSolver<Order>{puzzle, memory}, gated_{puzzle.find('0') == std::string_view::npos}
+  {}
+
+  bool solve()
+  {
+    while(gated_ and not gate_open)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    ++gated_solves;
+    return BasicSudokuSolver<Order>::solve();
+  }
+};
+
+TEST_CASE("Streaming mode stops reading while a slow chunk holds up the output", "[stream]")
+{
+  // the first chunk is stuck on its first puzzle, which is already solved
+  std::string input = std::string{SOLUTION} + '\n';
+  std::string expected = input;
+  for(std::size_t i = 1; i < 64 * BATCH_CHUNK_SIZE; ++i)
+  {
+    input += std::string{PUZZLE} + '\n';
+    expected += std::string{SOLUTION} + '\n';
+  }
+
+  int fds[2];
+  REQUIRE(::pipe(fds) == 0);
+  bool written = true;
+  std::thread writer{[&]() {
+    for(std::size_t pos = 0; pos < input.size(); pos += 4096)
+    {
+      auto size = std::min<std::size_t>(4096, input.size() - pos);
+      written = written and ::write(fds[1], input.data() + pos, size) == static_cast<ssize_t>(size);
+    }
+    ::close(fds[1]);
+  }};
+
+  // two workers may hold up to 8 chunks, the stuck one among them
+  std::size_t held = 0;
+  gate_open = false;
+  gated_solves = 0;
+  std::thread opener{[&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+    held = gated_solves;
+    gate_open = true;
+  }};
+
+  auto path = (std::filesystem::temp_directory_path() / "sudoku_slow_chunk_test.txt").string();
+  {
+    StreamReader reader{fds[0]};
+    OutputWriter output{path};
+    solve_stream<GatedSolver>(reader, 2, std::nullopt, output);
+    output.flush();
+  }
+  opener.join();
+  writer.join();
+  ::close(fds[0]);
+  REQUIRE(written);
+  REQUIRE(held < 8 * BATCH_CHUNK_SIZE);
+
+  MappedFile answers{path};
+  REQUIRE(answers.view() == expected);
+  std::filesystem::remove(path);
+}
+#endif
+
+
+#ifdef __linux__
+TEST_CASE("Output that doesn't reach the file is an error", "[output]")
+{
+  OutputWriter full{"/dev/full"};
+  full.write(PUZZLE);
+  REQUIRE_THROWS_AS(full.flush(), std::system_error);
+
+  std::string input{};
+  for(std::size_t i = 0; i < 100; ++i)
+  {
+    input += std::string{PUZZLE} + '\n';
+  }
+
+  int fds[2];
+  REQUIRE(::pipe(fds) == 0);
+  REQUIRE(::write(fds[1], input.data(), input.size()) == static_cast<ssize_t>(input.size()));
+  ::close(fds[1]);
+
+  StreamReader reader{fds[0]};
+  OutputWriter output{"/dev/full"};
+  REQUIRE_THROWS_AS(solve_stream<BasicSudokuSolver>(reader, 2, std::nullopt, output), std::system_error);
+  ::close(fds[0]);
+}
+#endif
+
+
+TEST_CASE("Packed puzzles round trip at every grid size", "[packed]")
+{
+  REQUIRE(PackedLayout<3>::RECORD_SIZE == 41);
+  REQUIRE(PackedLayout<2>::RECORD_SIZE == 6);
+  REQUIRE(PackedLayout<4>::RECORD_SIZE == 160);
+
+  auto round_trip = [](std::string_view puzzle) {
+    return with_order(order_for_cells(puzzle.size()), [&]<std::size_t Order>() {
+      std::string packed{};
+      pack_puzzle<Order>(puzzle, packed);
+      REQUIRE(packed.size() == PackedLayout<Order>::RECORD_SIZE);
+
+      std::string cells(puzzle.size(), ' ');
+      unpack_puzzle<Order>(packed, cells.data());
+      return cells;
+    });
+  };
+
+  REQUIRE(round_trip(PUZZLE) == PUZZLE);
+  REQUIRE(round_trip(SOLUTION) == SOLUTION);
+  REQUIRE(round_trip("0030102000400410") == "0030102000400410");
+  REQUIRE(round_trip(".03.1.2...4..41.") == "0030102000400410");
+
+  std::string big(256, '0');
+  std::string row = "123456789ABCDEFG";
+  std::copy(row.begin(), row.end(), big.begin());
+  REQUIRE(round_trip(big) == big);
+
+  std::string large(625, '0');
+  large[624] = 'P';
+  REQUIRE(round_trip(large) == large);
+
+  std::string packed{};
+  REQUIRE_THROWS_AS(pack_puzzle<3>(PUZZLE.substr(1), packed), std::invalid_argument);
+  REQUIRE_THROWS_AS(pack_puzzle<2>("0050000000000000", packed), std::invalid_argument);
+
+  // 4 bit cells can hold values past 9
+  std::string damaged(41, '\0');
+  damaged[3] = '\xA0';
+  std::string cells(81, ' ');
+  REQUIRE_THROWS_AS(unpack_puzzle<3>(damaged, cells.data()), std::invalid_argument);
+  REQUIRE_THROWS_AS(unpack_board<3>(damaged), std::invalid_argument);
+
+  packed.clear();
+  pack_puzzle<3>(PUZZLE, packed);
+  REQUIRE(unpack_board<3>(packed) == Board{PUZZLE});
+}
+
+
+TEST_CASE("Packed files solve like their text", "[packed][batch]")
+{
+  std::vector<std::string> puzzles{std::string{PUZZLE}, std::string(81, '0'), std::string{SOLUTION}};
+  std::string file{};
+  write_packed_header(3, puzzles.size(), file);
+  for(const auto& puzzle : puzzles)
+  {
+    pack_puzzle<3>(puzzle, file);
+  }
+  REQUIRE(file.size() == PACKED_HEADER_SIZE + 3 * 41);
+  REQUIRE(is_packed(file));
+
+  auto packed = read_packed(file);
+  REQUIRE(packed.order == 3);
+  REQUIRE(packed.count == 3);
+
+  std::vector<std::string> expected{}, chunks{};
+  solve_batch<BasicSudokuSolver>(std::span<const std::string>{puzzles}, 1, expected);
+  solve_packed_batch<BasicSudokuSolver>(packed, 0, packed.count, 2, chunks);
+  REQUIRE(chunks == expected);
+  solve_packed_batch<BasicDlxSolver>(packed, 1, 2, 1, chunks, 2);
+  REQUIRE(chunks == std::vector<std::string>{"2\n1\n"});
+
+  // headerless data is read as 9x9 records
+  auto raw = read_packed(std::string_view{file}.substr(PACKED_HEADER_SIZE));
+  REQUIRE(raw.count == 3);
+  REQUIRE(raw.record(2) == packed.record(2));
+
+  REQUIRE_THROWS_AS(read_packed(std::string_view{file}.substr(0, file.size() - 1)), std::invalid_argument);
+  REQUIRE_THROWS_AS(read_packed(std::string_view{file}.substr(PACKED_HEADER_SIZE + 1)), std::invalid_argument);
+  file[5] = 7;
+  REQUIRE_THROWS_AS(read_packed(file), std::invalid_argument);
+}
+
+
+TEST_CASE("One solver can be reloaded for many puzzles", "[solver][board]")
+{
+  Board board{PUZZLE};
+  REQUIRE(board.view() == PUZZLE);
+  REQUIRE(board.at(0, 2) == '3');
+  REQUIRE(board.num_clues() == 32);
+  REQUIRE(Board{".03"}.view().substr(0, 4) == "0030");
+  REQUIRE_THROWS_AS(Board{"x"}, std::invalid_argument);
+  REQUIRE_THROWS_AS(board.set(9, 0, '1'), std::invalid_argument);
+
+  auto copy = board;
+  // the only solution has a 4 there
+  copy.set(0, 0, '1');
+  REQUIRE(copy != board);
+  REQUIRE(copy.at(0, 0) == '1');
+
+  SudokuSolver solver{Board{}};
+  REQUIRE(solver.solve());
+  require_solved<3, BasicSudokuSolver>(solver.solution());
+
+  solver.load(PUZZLE);
+  REQUIRE(solver.puzzle() == board);
+  REQUIRE(solver.solve());
+  REQUIRE(solver.solution() == SOLUTION);
+
+  // reset gives back the puzzle and a fresh search
+  solver.reset();
+  REQUIRE(solver.solution() == PUZZLE);
+  REQUIRE(solver.count_solutions(2) == 1);
+
+  solver.load(copy);
+  REQUIRE_FALSE(solver.solve());
+
+  solver.load(std::string{"11"} + std::string(79, '0'));
+  REQUIRE(solver.get_game_state() == GameState::VIOLATION);
+  solver.load(board);
+  REQUIRE(solver.solve());
+  REQUIRE(solver.solution() == SOLUTION);
+
+  BasicSudokuSolver<2> small{BasicBoard<2>{"0030102000400410"}};
+  REQUIRE(small.count_solutions(5) == 2);
+  small.reset();
+  REQUIRE(small.count_solutions(5) == 2);
+}
+
+namespace {
+/**
+ * Passes allocations on to the heap, counting them.
+ */
+class CountingResource final : public std::pmr::memory_resource
+{
+public:
+  std::size_t allocations{0};
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+  {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+}// namespace
+
+TEST_CASE("Arenas hand out aligned memory and take it back on rewind", "[arena]")
+{
+  CountingResource heap{};
+  Arena arena{&heap};
+  REQUIRE(arena.capacity() == 0);
+
+  auto* byte = arena.allocate(1, 1);
+  auto* word = arena.allocate(8, 64);
+  REQUIRE(reinterpret_cast<std::uintptr_t>(word) % 64 == 0);
+  REQUIRE(word != byte);
+  REQUIRE(heap.allocations == 1);
+
+  auto mark = arena.mark();
+  auto* first = arena.allocate(100, 8);
+  arena.rewind(mark);
+  REQUIRE(arena.allocate(100, 8) == first);
+
+  // bigger than a block gets a block of its own, which stays for the next use
+  auto capacity = arena.capacity();
+  REQUIRE(arena.allocate(1 << 20, 16) != nullptr);
+  REQUIRE(arena.capacity() > capacity + (1 << 20) - 1);
+  REQUIRE(heap.allocations == 2);
+  arena.reset();
+  REQUIRE(arena.allocate(1 << 20, 16) != nullptr);
+  REQUIRE(heap.allocations == 2);
+
+  auto before = arena.mark();
+  {
+    ArenaScope scope{arena};
+    REQUIRE(scope.arena().allocate(64, 8) != nullptr);
+  }
+  REQUIRE(arena.mark().block == before.block);
+  REQUIRE(arena.mark().used == before.used);
+}
+
+TEST_CASE("Solvers on an arena stop allocating once it has grown", "[arena][solver][dlx]")
+{
+  static constexpr std::string_view HARD =
+    "100007090030020008009600500005300900010080002600004000300000010040000007007000300";
+
+  CountingResource heap{};
+  Arena arena{&heap};
+
+  auto solve_all = [&]<template <std::size_t> class Engine>() {
+    for(auto puzzle : {PUZZLE, HARD, PUZZLE})
+    {
+      ArenaScope scope{arena};
+      Engine<3> solver{puzzle, &scope.arena()};
+      REQUIRE(solver.solve());
+      require_solved<3, Engine>(solver.solution());
+    }
+  };
+
+  solve_all.operator()<BasicSudokuSolver>();
+  solve_all.operator()<BasicDlxSolver>();
+  auto warm = heap.allocations;
+  REQUIRE(warm > 0);
+
+  solve_all.operator()<BasicSudokuSolver>();
+  solve_all.operator()<BasicDlxSolver>();
+  REQUIRE(heap.allocations == warm);
+  REQUIRE(arena.mark().used == 0);
+}
+
+TEST_CASE("A search gives up once its budget runs out", "[solver][dlx][budget]")
+{
+  static constexpr std::string_view HARD =
+    "100007090030020008009600500005300900010080002600004000300000010040000007007000300";
+
+  auto check_engine = [&]<template <std::size_t> class Engine>() {
+    REQUIRE(Engine<3>{HARD}.solve(Budget{}) == GameState::SOLVED);
+    REQUIRE(Engine<3>{std::string{"11"}}.solve(Budget{}) == GameState::VIOLATION);
+
+    Budget few_nodes{};
+    few_nodes.max_nodes = 10;
+    REQUIRE(Engine<3>{HARD}.solve(few_nodes) == GameState::TIMED_OUT);
+
+    // a puzzle with its grid full needs no nodes
+    few_nodes.max_nodes = 0;
+    REQUIRE(Engine<3>{SOLUTION}.solve(few_nodes) == GameState::SOLVED);
+
+    auto late = Budget::within(std::chrono::seconds{-1});
+    REQUIRE(Engine<3>{HARD}.solve(late) == GameState::TIMED_OUT);
+    REQUIRE(Engine<3>{HARD}.solve(Budget::within(std::chrono::minutes{1})) == GameState::SOLVED);
+
+    std::stop_source cancel{};
+    Budget cancelled{};
+    cancelled.stop = cancel.get_token();
+    REQUIRE(Engine<3>{HARD}.solve(cancelled) == GameState::SOLVED);
+    cancel.request_stop();
+    REQUIRE(Engine<3>{HARD}.solve(cancelled) == GameState::TIMED_OUT);
+
+    // running out leaves the puzzle as it was, ready for another try
+    Engine<3> solver{HARD};
+    REQUIRE(solver.solve(cancelled) == GameState::TIMED_OUT);
+    REQUIRE(solver.solve());
+    require_solved<3, Engine>(solver.solution());
+    REQUIRE(solver.solution().substr(0, 9) == "162857493");
+  };
+
+  check_engine.operator()<BasicSudokuSolver>();
+  check_engine.operator()<BasicDlxSolver>();
+
+  // a cancelled count gives nothing and can be tried again
+  auto loose = std::string(27, '0') + std::string{PUZZLE.substr(27)};
+  SudokuSolver counter{loose};
+  std::stop_source cancel{};
+  Budget cancelled{};
+  cancelled.stop = cancel.get_token();
+  REQUIRE(counter.count_solutions(3, cancelled) == std::optional<std::size_t>{3});
+  cancel.request_stop();
+  REQUIRE_FALSE(counter.count_solutions(3, cancelled));
+  REQUIRE(counter.solution() == loose);
+  REQUIRE(counter.count_solutions(3) == 3);
+
+  BudgetMeter meter{[] {
+    Budget budget{};
+    budget.max_nodes = 5000;
+    return budget;
+  }()};
+  std::size_t spent = 0;
+  while(meter.spend())
+  {
+    ++spent;
+  }
+  REQUIRE(spent == 5000);
+  REQUIRE(meter.exhausted());
+  REQUIRE_FALSE(meter.spend());
+}
+
+namespace {
+/**
+ * A random symmetry of the 9x9 grid.
+ */
+Symmetry random_symmetry(std::mt19937& rng)
+{
+  Symmetry symmetry{};
+  symmetry.transpose = rng() % 2;
+
+  auto shuffle_lines = [&](std::array<std::uint8_t, 9>& lines) {
+    std::array<std::uint8_t, 3> groups{0, 1, 2};
+    std::shuffle(groups.begin(), groups.end(), rng);
+    for(std::size_t group = 0; group < 3; ++group)
+    {
+      std::array<std::uint8_t, 3> within{0, 1, 2};
+      std::shuffle(within.begin(), within.end(), rng);
+      for(std::size_t i = 0; i < 3; ++i)
+      {
+        lines[group * 3 + i] = static_cast<std::uint8_t>(groups[group] * 3 + within[i]);
+      }
+    }
+  };
+  shuffle_lines(symmetry.rows);
+  shuffle_lines(symmetry.cols);
+
+  std::copy_n(DIGITS.begin(), 9, symmetry.digits.begin());
+  std::shuffle(symmetry.digits.begin(), symmetry.digits.end(), rng);
+  return symmetry;
+}
+
+std::string transformed(const Symmetry& symmetry, std::string_view grid)
+{
+  std::string out(grid.size(), EMPTY_CELL);
+  symmetry.apply(grid, out.data());
+  return out;
+}
+}// namespace
+
+TEST_CASE("Symmetric variants share their canonical form", "[canonical]")
+{
+  static constexpr std::string_view HARD =
+    "480300000000000071020000000705000060000200800000000000001076000300000400000050000";
+
+  std::mt19937 rng{7};
+  for(auto puzzle : {PUZZLE, SOLUTION, HARD})
+  {
+    auto canonical = canonicalize(Board{puzzle});
+    REQUIRE(canonical);
+    REQUIRE(transformed(canonical->symmetry, puzzle) == canonical->form);
+
+    std::string back(puzzle.size(), EMPTY_CELL);
+    canonical->symmetry.revert(canonical->form, back.data());
+    REQUIRE(back == puzzle);
+
+    for(int i = 0; i < 20; ++i)
+    {
+      auto variant = transformed(random_symmetry(rng), puzzle);
+      auto variant_form = canonicalize(Board{variant});
+      REQUIRE(variant_form);
+      REQUIRE(variant_form->form == canonical->form);
+    }
+  }
+
+  REQUIRE(canonicalize(Board{PUZZLE})->form != canonicalize(Board{HARD})->form);
+  // every symmetry keeps the empty grid as it is
+  REQUIRE_FALSE(canonicalize(Board{}));
+}
+
+TEST_CASE("LRU caches drop the least recently used entry", "[cache]")
+{
+  ShardedLruCache<int, std::string> cache{2, 1};
+  REQUIRE(cache.capacity() == 2);
+
+  cache.put(1, "one");
+  cache.put(2, "two");
+  REQUIRE(cache.get(1) == "one");
+  cache.put(3, "three");
+  REQUIRE(cache.size() == 2);
+  REQUIRE_FALSE(cache.get(2));
+  REQUIRE(cache.get(3) == "three");
+
+  cache.put(1, "uno");
+  REQUIRE(cache.get(1) == "uno");
+  REQUIRE(cache.hits() == 3);
+  REQUIRE(cache.misses() == 1);
+
+  ShardedLruCache<int, int> empty{0};
+  empty.put(1, 1);
+  REQUIRE_FALSE(empty.get(1));
+
+  // entries that fit stay whatever threads put them there
+  ShardedLruCache<int, int> shared{1 << 16, 8};
+  std::vector<std::thread> threads{};
+  for(int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&shared, t]() {
+      for(int i = 0; i < 1000; ++i)
+      {
+        shared.put(t * 1000 + i, i);
+        shared.get(t * 1000 + i / 2);
+      }
+    });
+  }
+  for(auto& thread : threads)
+  {
+    thread.join();
+  }
+  REQUIRE(shared.size() == 4000);
+  REQUIRE(shared.get(3999) == 999);
+}
+
+TEST_CASE("Cached batches answer symmetric variants of hard puzzles", "[cache][batch]")
+{
+  static constexpr std::string_view HARD =
+    "480300000000000071020000000705000060000200800000000000001076000300000400000050000";
+
+  std::mt19937 rng{11};
+  std::vector<std::string> puzzles{std::string{PUZZLE}, std::string{HARD}, std::string{"11"} + std::string(79, '0')};
+  for(int i = 0; i < 30; ++i)
+  {
+    puzzles.push_back(transformed(random_symmetry(rng), HARD));
+  }
+  puzzles.emplace_back("0030102000400410");
+
+  auto check = [&]<template <std::size_t> class Engine>(std::size_t min_hits) {
+    SolutionCache cache{64};
+    std::vector<std::string> chunks{};
+    solve_batch<Engine>(std::span<const std::string>{puzzles}, 2, chunks, std::nullopt, &cache);
+
+    std::string all = std::accumulate(chunks.begin(), chunks.end(), std::string{});
+    RecordReader lines{all};
+    std::string_view line{};
+    for(const auto& puzzle : puzzles)
+    {
+      REQUIRE(lines.next(line));
+      if(puzzle.starts_with("11"))
+      {
+        REQUIRE(line == NO_SOLUTION);
+        continue;
+      }
+
+      for(std::size_t i = 0; i < puzzle.size(); ++i)
+      {
+        REQUIRE((puzzle[i] == EMPTY_CELL or puzzle[i] == line[i]));
+      }
+      with_solver<BasicSudokuSolver>(line, [](auto& solver) { REQUIRE(solver.get_game_state() == GameState::SOLVED); });
+    }
+    REQUIRE_FALSE(lines.next(line));
+
+    // variants the search doesn't settle quickly are answered from the first one
+    REQUIRE(cache.size() <= 1);
+    REQUIRE(cache.hits() >= min_hits);
+  };
+
+  check.operator()<BasicSudokuSolver>(15);
+  check.operator()<BasicDlxSolver>(0);
+}
+
+TEST_CASE("The C API solves batches of puzzle records", "[capi]")
+{
+  std::string puzzles = std::string{PUZZLE} + std::string{"11"} + std::string(79, '.') + std::string{PUZZLE};
+  std::string out(puzzles.size(), 'x');
+
+  REQUIRE(sudoku_solve_batch(puzzles.data(), 3, out.data()) == 2);
+  REQUIRE(out.substr(0, SUDOKU_CELLS) == SOLUTION);
+  REQUIRE(out.substr(SUDOKU_CELLS, SUDOKU_CELLS) == std::string(SUDOKU_CELLS, EMPTY_CELL));
+  REQUIRE(out.substr(2 * SUDOKU_CELLS) == SOLUTION);
+
+  std::string many{};
+  for(int i = 0; i < 1000; ++i)
+  {
+    many.append(PUZZLE);
+  }
+  std::string many_out(many.size(), 'x');
+  REQUIRE(sudoku_solve_batch_parallel(many.data(), 1000, many_out.data(), 0) == 1000);
+  REQUIRE(many_out.substr(999 * SUDOKU_CELLS) == SOLUTION);
+
+  REQUIRE(sudoku_solve_batch(nullptr, 0, nullptr) == 0);
+
+  // each puzzle reports what became of it, an invalid one among them
+  puzzles[5] = 'x';
+  std::vector<unsigned char> status(3, 0xFF);
+  REQUIRE(sudoku_solve_batch_status(puzzles.data(), 3, out.data(), status.data(), 2) == 1);
+  REQUIRE(status == std::vector<unsigned char>{SUDOKU_INVALID, SUDOKU_UNSOLVABLE, SUDOKU_SOLVED});
+  REQUIRE(out.substr(0, SUDOKU_CELLS) == std::string(SUDOKU_CELLS, EMPTY_CELL));
+  REQUIRE(out.substr(2 * SUDOKU_CELLS) == SOLUTION);
+
+  // puzzles the lockstep propagation leaves open go through the search
+  static constexpr std::string_view HARD =
+    "100007090030020008009600500005300900010080002600004000300000010040000007007000300";
+  std::string hard{};
+  for(int i = 0; i < 20; ++i)
+  {
+    hard.append(i % 2 ? HARD : PUZZLE);
+  }
+  std::string hard_out(hard.size(), 'x');
+  status.assign(20, 0xFF);
+  REQUIRE(sudoku_solve_batch_status(hard.data(), 20, hard_out.data(), status.data(), 1) == 20);
+  REQUIRE(status == std::vector<unsigned char>(20, SUDOKU_SOLVED));
+  SudokuSolver hard_solver{HARD};
+  REQUIRE(hard_solver.solve());
+  REQUIRE(hard_out.substr(SUDOKU_CELLS, SUDOKU_CELLS) == hard_solver.solution());
+  REQUIRE(hard_out.substr(0, SUDOKU_CELLS) == SOLUTION);
+}
+
+
+TEST_CASE("Ratings name the hardest technique a puzzle needs", "[rating]")
+{
+  BasicSudokuSolver<3> easy{PUZZLE};
+  auto rating = easy.rate();
+  REQUIRE(rating.state == GameState::SOLVED);
+  REQUIRE(rating.hardest == Technique::HIDDEN_SINGLE);
+  REQUIRE(rating.score == rating.steps * TECHNIQUE_WEIGHTS[static_cast<std::size_t>(Technique::HIDDEN_SINGLE)]);
+  auto easy_score = rating.score;
+
+  // rating leaves the puzzle as it was loaded
+  REQUIRE(easy.get_game_state() == GameState::VALID);
+  REQUIRE(easy.solve());
+  REQUIRE(easy.solution() == SOLUTION);
+
+  auto [puzzle, technique] = GENERATE(table<std::string_view, Technique>({
+    {"400000805030000000000700000020000060000080400000010000000603070500200000104000000", Technique::LOCKED_CANDIDATES},
+    {"050700000080039000107600500000050302062370000090000000000000274001000009800000005", Technique::NAKED_PAIR},
+    {"000010068000800700000069050900006000007000003100500004002600000500000040700301096", Technique::HIDDEN_PAIR},
+    {"000010400006080000500000060000000000014830900007060030300000091080005600090000200", Technique::NAKED_TRIPLE},
+    {"000170800060023005000000200000000004090060300400009080001306700630510000900200000", Technique::HIDDEN_TRIPLE},
+    {"900400050000007080015009003200000300000010000000200604002000000006800005140000090", Technique::X_WING},
+    {"004200010780900000000060300040100700200080040007000000053040000960010004002005008", Technique::SWORDFISH},
+  }));
+  CAPTURE(puzzle);
+  BasicSudokuSolver<3> solver{puzzle};
+  rating = solver.rate();
+  REQUIRE(rating.state == GameState::SOLVED);
+  REQUIRE(rating.hardest == technique);
+  REQUIRE(rating.score > rating.steps);
+
+  // the techniques alone get stuck on this one
+  BasicSudokuSolver<3> hard{"100007090030020008009600500005300900010080002600004000300000010040000007007000300"};
+  rating = hard.rate();
+  REQUIRE(rating.state == GameState::VALID);
+  REQUIRE(rating.hardest == Technique::SEARCH);
+
+  REQUIRE(BasicSudokuSolver<3>{std::string{"11"}}.rate().state == GameState::VIOLATION);
+
+  std::vector<std::string> puzzles{std::string{PUZZLE}, std::string{"11"}};
+  std::vector<std::string> chunks{};
+  rate_batch(std::span<const std::string>{puzzles}, 2, chunks);
+  REQUIRE(chunks.size() == 1);
+  REQUIRE(chunks[0] == fmt::format("{} hidden-single\n{}\n", easy_score, NO_SOLUTION));
+}